@@ -0,0 +1,301 @@
+#include "generator.hpp"
+
+#include <grib2dec/grib2dec.hpp>
+
+// library internals, for decoding phases
+#include "sections.hpp"
+#include "stream.hpp"
+#include "struct.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+using namespace grib2dec_bench;
+
+namespace {
+
+struct Config {
+    const char *name;
+    GeneratorOptions options;
+};
+
+struct Parameters {
+    vector<double> resolutions = {1., 0.5, 0.25, 0.1};
+    double minTime = 0.3;
+};
+
+struct Result {
+    double seconds;  // by iteration
+    double values;   // by iteration, or points of queries
+    double bytes;    // by iteration, 0 if not measured
+    double messages; // by iteration, 0 if not measured
+};
+
+int usage()
+{
+    cerr << "grib2dec-bench : decoding benchmarks on synthetic grib2 messages" << endl;
+    cerr << "usage:" << endl;
+    cerr << " --resolutions r1,r2,... : grid resolutions in degree (default: 1,0.5,0.25,0.1)" << endl;
+    cerr << " --time seconds : minimum time by measure (default: 0.3)" << endl;
+    cerr << "wind query rows give ns/value by queried point" << endl;
+    return -1;
+}
+
+bool parseArguments(int argc, char *argv[], Parameters& params)
+{
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i == argc - 1)
+            return false; // all arguments have a parameter
+        if (arg == "--resolutions") {
+            params.resolutions.clear();
+            stringstream ss(argv[++i]);
+            string r;
+            while (getline(ss, r, ','))
+                params.resolutions.push_back(atof(r.c_str()));
+        } else if (arg == "--time") {
+            params.minTime = atof(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return !params.resolutions.empty();
+}
+
+// repeat function until minimum time, returns seconds by iteration
+double measure(const function<void()>& f, double minTime)
+{
+    using clock = chrono::steady_clock;
+    int iterations = 0;
+    auto start = clock::now();
+    double elapsed;
+
+    do {
+        f();
+        iterations++;
+        elapsed = chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < minTime);
+
+    return elapsed / iterations;
+}
+
+void report(const string& config, const string& grid, const char *phase,
+            const Result& r)
+{
+    printf("%-22s %-12s %-8s %10.2f", config.c_str(), grid.c_str(), phase,
+           r.seconds * 1e9 / r.values);
+
+    // queries read no bytes and no messages
+    if (r.bytes > 0)
+        printf(" %10.1f %12.1f\n", r.bytes / r.seconds / 1e6, r.messages / r.seconds);
+    else
+        printf(" %10s %12s\n", "-", "-");
+}
+
+/*
+ * Message parsed up to data section, to decode data section alone.
+ */
+struct Prepared {
+    grib2dec::Message message;
+    streampos dataPos;
+    size_t dataLen;
+};
+
+void prepare(istream& fin, const G2DEC_SpatialFilter& filter,
+             Prepared& prepared)
+{
+    grib2dec::Stream stream(fin);
+    grib2dec::Message& message = prepared.message;
+    vector<double> values;
+
+    fin.clear();
+    fin.seekg(0);
+
+    // skips of spatial filter are computed with grid section
+    message.filter.spatialFilter = filter;
+    grib2dec::readIndicatorSection(stream, message);
+
+    while (true) {
+        // peek section id
+        streampos pos = fin.tellg();
+        char header[5];
+        fin.read(header, 5);
+        fin.seekg(pos);
+
+        if (header[4] == 7) {
+            prepared.dataPos = pos;
+            prepared.dataLen = grib2dec::len32(header);
+            return;
+        }
+
+        grib2dec::readSection(stream, message, values);
+    }
+}
+
+Result bitsPhase(const Prepared& prepared, double minTime)
+{
+    const int nbValues = prepared.message.packing.nbValues;
+    const int nbBits = max<int>(1, prepared.dataLen * 8 / nbValues);
+
+    string data(size_t(nbValues) * nbBits / 8 + 8, '\0');
+    mt19937 random(1);
+    for (char& c : data)
+        c = random();
+
+    istringstream fin(data);
+    int sum = 0;
+
+    double seconds = measure([&]() {
+        fin.clear();
+        fin.seekg(0);
+        grib2dec::Stream stream(fin);
+        for (int i = 0; i < nbValues; i++)
+            sum += stream.bits(nbBits);
+    }, minTime);
+
+    if (sum == 42)
+        cerr << endl; // keep sum alive
+
+    return {seconds, double(nbValues), nbValues * nbBits / 8., 1.};
+}
+
+Result dataPhase(istream& fin, const Prepared& prepared, double minTime)
+{
+    vector<double> values;
+    grib2dec::Message message;
+
+    double seconds = measure([&]() {
+        fin.clear();
+        fin.seekg(prepared.dataPos);
+        grib2dec::Stream stream(fin);
+        message = prepared.message;
+        grib2dec::readSection(stream, message, values);
+    }, minTime);
+
+    return {seconds, double(prepared.message.packing.nbValues),
+            double(prepared.dataLen), 1.};
+}
+
+Result decodePhase(const string& data, double minTime)
+{
+    istringstream fin(data);
+    double nbValues = 0, nbMessages = 0;
+
+    double seconds = measure([&]() {
+        fin.clear();
+        fin.seekg(0);
+        grib2dec::Grib2Dec *decoder = grib2dec::Grib2Dec::create(fin);
+        nbValues = nbMessages = 0;
+
+        G2DEC_Message message;
+        while (decoder->nextMessage(message) == G2DEC_STATUS_OK) {
+            nbValues += message.valuesLength;
+            nbMessages++;
+        }
+
+        delete decoder;
+    }, minTime);
+
+    return {seconds, nbValues, double(data.size()), nbMessages};
+}
+
+Result windPhase(const string& data, double minTime)
+{
+    istringstream fin(data);
+    grib2dec::WindQuery *wind = grib2dec::WindQuery::create();
+    wind->load(fin);
+
+    const double *times;
+    int nbTimes;
+    wind->getTimes(times, nbTimes);
+
+    // random points in space and in time range of fields
+    const int nbPoints = 1 << 16;
+    vector<G2DEC_WindPoint> points(nbPoints);
+    vector<double> u(nbPoints), v(nbPoints);
+    mt19937 random(1);
+    uniform_real_distribution<double> lat(-90., 90.), lon(-180., 540.);
+    uniform_real_distribution<double> time(nbTimes ? times[0] : 0.,
+                                           nbTimes ? times[nbTimes - 1] : 0.);
+
+    for (G2DEC_WindPoint& point : points)
+        point = {lat(random), lon(random), time(random)};
+
+    double seconds = measure([&]() {
+        wind->query(points.data(), nbPoints, u.data(), v.data());
+    }, minTime);
+
+    delete wind;
+    return {seconds, double(nbPoints), 0., 0.};
+}
+
+} // local namespace
+
+int main(int argc, char *argv[])
+{
+    Parameters params;
+    if (!parseArguments(argc, argv, params))
+        return usage();
+
+    vector<Config> configs = {
+        {"5.2 groups 8-32", {}},
+        {"5.3 order 1", {}},
+        {"5.3 order 2", {}},
+        {"5.3 order 2 groups 128", {}},
+        {"5.3 order 2 wide", {}},
+    };
+
+    configs[0].options.tpl = 2;
+    configs[1].options.spatialOrder = 1;
+    configs[3].options.minGroupLength = 64;
+    configs[3].options.maxGroupLength = 192;
+    configs[4].options.noiseBits = 10;
+
+    // quarter of the globe for filter phase
+    const G2DEC_SpatialFilter noFilter = {0., 0., 0., 0.};
+    const G2DEC_SpatialFilter filter = {0., 90., 90., 270.};
+
+    printf("%-22s %-12s %-8s %10s %10s %12s\n", "config", "grid", "phase",
+           "ns/value", "MB/s", "messages/s");
+
+    for (double resolution : params.resolutions) {
+        for (Config& config : configs) {
+            config.options.resolution = resolution;
+            config.options.nbMessages = 2;
+
+            const string data = generate(config.options);
+
+            ostringstream grid;
+            grid << resolution << "deg";
+
+            istringstream fin(data);
+            Prepared prepared, filtered;
+            prepare(fin, noFilter, prepared);
+            prepare(fin, filter, filtered);
+
+            report(config.name, grid.str(), "bits", bitsPhase(prepared, params.minTime));
+            report(config.name, grid.str(), "data", dataPhase(fin, prepared, params.minTime));
+            report(config.name, grid.str(), "filter", dataPhase(fin, filtered, params.minTime));
+            report(config.name, grid.str(), "decode", decodePhase(data, params.minTime));
+        }
+
+        // U and V at 4 times, queried in space and time
+        GeneratorOptions windOptions;
+        windOptions.resolution = resolution;
+        windOptions.nbMessages = 8;
+
+        ostringstream grid;
+        grid << resolution << "deg";
+        report("wind 4 times", grid.str(), "query",
+               windPhase(generate(windOptions), params.minTime));
+    }
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+#include "generator.hpp"
+
+// grib2 writing of library encoder
+#include "writer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+using namespace grib2dec;
+
+namespace grib2dec_bench {
+
+namespace {
+
+string identificationSection(int hour)
+{
+    string s;
+    put16(s, 7);     // center
+    put16(s, 0);     // subcenter
+    put8(s, 2);      // master table version
+    put8(s, 1);      // local tables version
+    put8(s, 1);      // significance of reference time
+    put16(s, 2020);
+    put8(s, 5);
+    put8(s, 17);
+    put8(s, hour);
+    put8(s, 0);
+    put8(s, 0);
+    put8(s, 0);      // production status
+    put8(s, 1);      // forecast
+    string out;
+    section(out, 1, s);
+    return out;
+}
+
+string gridSection(int ni, int nj, double resolution)
+{
+    const double subdivision = 1e6;
+    string s;
+    put8(s, 0);              // source of grid definition
+    put32(s, ni * nj);
+    put8(s, 0);
+    put8(s, 0);
+    put16(s, 0);             // template 3.0
+    put8(s, 6);              // earth shape
+    put8(s, 0);
+    put32(s, 0);
+    s += string(10, '\0');
+    put32(s, ni);
+    put32(s, nj);
+    put32(s, 0);             // basic angle
+    put32(s, 0xffffffff);    // subdivisions
+    put32(s, magSigned32(lround(90 * subdivision)));
+    put32(s, 0);
+    put8(s, 48);
+    put32(s, magSigned32(lround(-90 * subdivision)));
+    put32(s, magSigned32(lround((ni - 1) * resolution * subdivision)));
+    put32(s, lround(resolution * subdivision));
+    put32(s, lround(resolution * subdivision));
+    put8(s, 0);              // scanning mode
+    string out;
+    section(out, 3, s);
+    return out;
+}
+
+string productSection(int parameter)
+{
+    string s;
+    put16(s, 0);             // number of coords
+    put16(s, 0);             // template 4.0
+    put8(s, 2);              // momentum
+    put8(s, parameter);
+    put8(s, 2);
+    put8(s, 0);
+    put8(s, 96);
+    put16(s, 0);
+    put8(s, 0);
+    put8(s, 1);              // hour
+    put32(s, 0);
+    put8(s, 103);            // height above ground
+    put8(s, 0);
+    put32(s, 10);
+    put8(s, 255);
+    put8(s, 0);
+    put32(s, 0);
+    string out;
+    section(out, 4, s);
+    return out;
+}
+
+// smooth field with noise, as positive integers
+vector<int> field(int ni, int nj, int component, const GeneratorOptions& options,
+                  mt19937& random)
+{
+    uniform_int_distribution<int> noise(0, (1 << options.noiseBits) - 1);
+    vector<int> values(size_t(ni) * nj);
+
+    for (int j = 0; j < nj; j++) {
+        double lat = (90. - j * options.resolution) * M_PI / 180.;
+        for (int i = 0; i < ni; i++) {
+            double lon = i * options.resolution * M_PI / 180.;
+            double v = component == 0 ? sin(3 * lon) * cos(2 * lat)
+                                      : cos(2 * lon) * sin(4 * lat);
+            values[size_t(j) * ni + i] = lround(2000 + 1500 * v) + noise(random);
+        }
+    }
+
+    return values;
+}
+
+void pack(const vector<int>& values, const GeneratorOptions& options,
+          mt19937& random, string& section5, string& section7)
+{
+    const int n = values.size();
+    const int order = options.tpl == 3 ? options.spatialOrder : 0;
+
+    // spatial differences
+    vector<int> packed(n, 0);
+    int hmin = 0;
+
+    if (order > 0) {
+        for (int k = order; k < n; k++) {
+            packed[k] = order == 1 ? values[k] - values[k - 1]
+                                   : values[k] - 2 * values[k - 1] + values[k - 2];
+        }
+        hmin = *min_element(packed.begin() + order, packed.end());
+        for (int k = order; k < n; k++)
+            packed[k] -= hmin;
+    } else {
+        packed = values;
+    }
+
+    // groups
+    uniform_int_distribution<int> groupLength(options.minGroupLength,
+                                              options.maxGroupLength);
+    vector<int> refs, widths, lengths;
+
+    for (int begin = 0; begin < n; ) {
+        int len = min(groupLength(random), n - begin);
+        auto range = minmax_element(packed.begin() + begin, packed.begin() + begin + len);
+        refs.push_back(*range.first);
+        widths.push_back(nbBits(*range.second - *range.first));
+        lengths.push_back(len);
+        begin += len;
+    }
+
+    const int ng = refs.size();
+    const int refBits = max(1, nbBits(*max_element(refs.begin(), refs.end())));
+    const int widthBits = max(1, nbBits(*max_element(widths.begin(), widths.end())));
+    const int lengthRef = *min_element(lengths.begin(), lengths.end());
+    const int lengthBits = max(1, nbBits(*max_element(lengths.begin(), lengths.end()) - lengthRef));
+
+    // section 5
+    string s;
+    put32(s, n);
+    put16(s, options.tpl);
+    put32(s, 0);             // R = 0.f
+    put16(s, 0);             // E
+    put16(s, 1);             // D
+    put8(s, refBits);
+    put8(s, 0);
+    put8(s, 1);              // group splitting method
+    put8(s, 0);              // no missing values
+    put32(s, 0);
+    put32(s, 0);
+    put32(s, ng);
+    put8(s, 0);              // group width reference
+    put8(s, widthBits);
+    put32(s, lengthRef);
+    put8(s, 1);              // length increment
+    put32(s, lengths.back());
+    put8(s, lengthBits);
+    if (options.tpl == 3) {
+        put8(s, order);
+        put8(s, 4);          // extra descriptors octets
+    }
+    section(section5, 5, s);
+
+    // section 7
+    string d;
+    if (order > 0) {
+        put32(d, magSigned32(values[0]));
+        if (order == 2)
+            put32(d, magSigned32(values[1]));
+        put32(d, magSigned32(hmin));
+    }
+
+    BitWriter writer(d);
+
+    for (int v : refs)
+        writer.bits(v, refBits);
+    writer.end();
+
+    for (int v : widths)
+        writer.bits(v, widthBits);
+    writer.end();
+
+    for (int v : lengths)
+        writer.bits(v - lengthRef, lengthBits);
+    writer.end();
+
+    for (int g = 0, k = 0; g < ng; g++) {
+        for (int l = 0; l < lengths[g]; l++, k++)
+            writer.bits(packed[k] - refs[g], widths[g]);
+    }
+    writer.end();
+
+    section(section7, 7, d);
+}
+
+} // local namespace
+
+string generate(const GeneratorOptions& options)
+{
+    mt19937 random(options.seed);
+
+    const int ni = lround(360. / options.resolution);
+    const int nj = lround(180. / options.resolution) + 1;
+
+    string out;
+
+    for (int m = 0; m < options.nbMessages; m++) {
+        const int component = m % 2;
+        string section5, section7;
+        pack(field(ni, nj, component, options, random), options, random,
+             section5, section7);
+
+        string body = identificationSection(m / 2 % 24) +
+                      gridSection(ni, nj, options.resolution) +
+                      productSection(2 + component) + section5;
+        section(body, 6, string(1, char(255)));
+        body += section7 + "7777";
+
+        out += "GRIB";
+        put16(out, 0);
+        put8(out, 0);        // meteorological
+        put8(out, 2);        // edition
+        put64(out, body.size() + 16);
+        out += body;
+    }
+
+    return out;
+}
+
+} // grib2dec_bench
@@ -0,0 +1,35 @@
+#ifndef __BENCH_GENERATOR_HPP
+#define __BENCH_GENERATOR_HPP
+
+#include <string>
+
+namespace grib2dec_bench {
+
+struct GeneratorOptions {
+    // grid resolution in degree, global latitude / longitude grid
+    double resolution = 1.;
+
+    // data representation template, 2 or 3, and spatial order for 3
+    int tpl = 3;
+    int spatialOrder = 2;
+
+    // groups length are randomly chosen in [min, max]
+    int minGroupLength = 8;
+    int maxGroupLength = 32;
+
+    // noise amplitude added to smooth field, in bits: changes groups width
+    int noiseBits = 4;
+
+    int nbMessages = 1;
+    unsigned seed = 1;
+};
+
+/**
+ * Generate grib2 messages of synthetic wind components with complex
+ * packing, alternatively U and V.
+ */
+std::string generate(const GeneratorOptions& options);
+
+} // grib2dec_bench
+
+#endif
@@ -0,0 +1,194 @@
+#include <grib2dec/grib2dec.hpp>
+
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Parameters {
+    string outputFile;
+    string queryFile;
+    double queryLat = 0., queryLon = 0.;
+    vector<G2DEC_Selection> parameters;
+    vector<const char*> inputs;
+    G2DEC_CubeOptions options = {{0., 0., 0., 0.}, 0, 0};
+};
+
+int usage()
+{
+    cerr << "grib2dec-cube : point-major time series cube of forecast files" << endl;
+    cerr << "usage:" << endl;
+    cerr << " grib2dec-cube -o cube [options] file1.grb2 file2.grb2 ..." << endl;
+    cerr << " grib2dec-cube --query lat,lon cube" << endl;
+    cerr << "options:" << endl;
+    cerr << " --parameter id[,levelType[:level]] : parameter of cube, can be repeated" << endl;
+    cerr << " --region latMin,latMax,lonMin,lonMax : region of cube (default: whole grid)" << endl;
+    cerr << " --block points : points transposed at once (default: 4096)" << endl;
+    cerr << " --threads n : decoding threads (default: hardware concurrency)" << endl;
+    cerr << "one time by file, in order of files" << endl;
+    return -1;
+}
+
+int error(const char *msg, const char *msg2 = nullptr)
+{
+    cerr << "error: " << msg;
+    if (msg2)
+        cerr << msg2;
+    cerr << endl;
+    return -1;
+}
+
+bool parseParameter(const char *arg, Parameters& params)
+{
+    G2DEC_Selection selection = {G2DEC_PARAMETER_UNKNOWN, -1, -1., -1,
+                                 G2DEC_TIME_UNIT_HOUR, -1, -1};
+    int parameter;
+
+    if (sscanf(arg, "%d,%d:%lf", &parameter, &selection.levelType,
+               &selection.level) < 1)
+        return false;
+
+    selection.parameter = static_cast<G2DEC_Parameter>(parameter);
+    params.parameters.push_back(selection);
+    return true;
+}
+
+bool parseArguments(int argc, char *argv[], Parameters& params)
+{
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.size() < 2 || arg[0] != '-') {
+            params.inputs.push_back(argv[i]);
+            continue;
+        }
+
+        // number of values of option
+        const int nbValues = arg == "--query" ? 2 : 1;
+        if (i + nbValues >= argc)
+            return error("missing value of ", argv[i]), false;
+
+        if (arg == "-o")
+            params.outputFile = argv[++i];
+        else if (arg == "--query") {
+            if (sscanf(argv[++i], "%lf,%lf", &params.queryLat, &params.queryLon) != 2)
+                return error("bad query ", argv[i]), false;
+            params.queryFile = argv[++i];
+        } else if (arg == "--parameter") {
+            if (!parseParameter(argv[++i], params))
+                return error("bad parameter ", argv[i]), false;
+        } else if (arg == "--region") {
+            G2DEC_SpatialFilter& region = params.options.region;
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &region.latMin, &region.latMax,
+                       &region.lonMin, &region.lonMax) != 4)
+                return error("bad region ", argv[i]), false;
+        } else if (arg == "--block") {
+            params.options.blockPoints = atoi(argv[++i]);
+            if (params.options.blockPoints <= 0)
+                return error("bad block ", argv[i]), false;
+        } else if (arg == "--threads") {
+            params.options.threads = atoi(argv[++i]);
+            if (params.options.threads <= 0)
+                return error("bad threads ", argv[i]), false;
+        } else
+            return error("unknown option ", argv[i]), false;
+    }
+
+    if (!params.queryFile.empty())
+        return params.inputs.empty();
+
+    return !params.outputFile.empty() && !params.parameters.empty() &&
+           !params.inputs.empty();
+}
+
+// nearest point of a regular grid
+int nearestPoint(const G2DEC_Grid& grid, double lat, double lon)
+{
+    if (grid.projection.type != G2DEC_PROJECTION_NONE || grid.gaussianN)
+        return -1;
+
+    const double latStep = grid.nj > 1 ? (grid.lat2 - grid.lat1) / (grid.nj - 1) : 1.;
+    const double lonStep = grid.ni > 1 ? (grid.lon2 - grid.lon1) / (grid.ni - 1) : 1.;
+    const int i = lround(fmod(lon - grid.lon1 + 720., 360.) / lonStep);
+    const int j = lround((lat - grid.lat1) / latStep);
+
+    if (i < 0 || i >= grid.ni || j < 0 || j >= grid.nj)
+        return -1;
+
+    return j * grid.ni + i;
+}
+
+int query(const Parameters& params)
+{
+    const char *filename = params.queryFile.c_str();
+    G2DEC_CubeHeader header;
+
+    if (grib2dec::readCubeHeader(filename, header) != G2DEC_STATUS_OK)
+        return error("cannot read cube ", filename);
+
+    const int point = nearestPoint(header.grid, params.queryLat, params.queryLon);
+    if (point < 0)
+        return error("query point out of regular grid");
+
+    vector<float> values(header.nbParameters * header.nbTimes);
+    if (grib2dec::readCubePoint(filename, point, values.data()) != G2DEC_STATUS_OK)
+        return error("cannot read point of ", filename);
+
+    // parameters and times are after header
+    FILE *fin = fopen(filename, "rb");
+    vector<G2DEC_Selection> parameters(header.nbParameters);
+    vector<G2DEC_CubeTime> times(header.nbTimes);
+    fseek(fin, sizeof(header), SEEK_SET);
+    const bool ok =
+        fread(parameters.data(), sizeof(G2DEC_Selection), parameters.size(), fin) == parameters.size() &&
+        fread(times.data(), sizeof(G2DEC_CubeTime), times.size(), fin) == times.size();
+    fclose(fin);
+    if (!ok)
+        return error("cannot read cube ", filename);
+
+    printf("%-20s %10s", "reference", "forecast");
+    for (const G2DEC_Selection& parameter : parameters)
+        printf(" %12d", parameter.parameter);
+    printf("\n");
+
+    for (int t = 0; t < header.nbTimes; t++) {
+        const G2DEC_Datetime& d = times[t].reference;
+        printf("%04d-%02d-%02dT%02d:%02d:%02d %10lld", d.year, d.month, d.day,
+               d.hour, d.minute, d.second, times[t].forecastSeconds);
+        for (int p = 0; p < header.nbParameters; p++)
+            printf(" %12g", values[p * header.nbTimes + t]);
+        printf("\n");
+    }
+
+    return 0;
+}
+
+} // local namespace
+
+int main(int argc, char *argv[])
+{
+    Parameters params;
+    if (!parseArguments(argc, argv, params))
+        return usage();
+
+    if (!params.queryFile.empty())
+        return query(params);
+
+    string cubeError;
+    const G2DEC_Status status = grib2dec::buildCube(
+        params.inputs.data(), params.inputs.size(), params.parameters.data(),
+        params.parameters.size(), params.options, params.outputFile.c_str(),
+        &cubeError);
+
+    if (status != G2DEC_STATUS_OK)
+        cerr << cubeError << endl;
+
+    return status == G2DEC_STATUS_OK ? 0 : -1;
+}
@@ -1,11 +1,22 @@
+#include "output/expression.hpp"
 #include "output/output.hpp"
 
 #include <grib2dec/grib2dec.hpp>
 #include <grib2dec/grib2dec.h>
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 #include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <vector>
 
 using namespace std;
 using namespace grib2dec_demo;
@@ -14,7 +25,20 @@ struct Parameters {
     string inputFile;
     string outputFile;
     string outputFormat;
+    OutputOptions outputOptions;
     G2DEC_SpatialFilter filter;
+    G2DEC_Decimation decimation = {1, 1, 0};
+    vector<G2DEC_SpatialFilter> regions;
+    vector<G2DEC_Point> points;
+    vector<G2DEC_Selection> selections;
+    G2DEC_Interpolation interpolation = G2DEC_INTERPOLATION_NEAREST;
+    G2DEC_Grid regrid;
+    bool stats = false;
+    G2DEC_LogLevel logLevel = G2DEC_LOG_WARNING;
+    bool recovery = false;
+    string traceFile;
+    int benchIterations = 0;
+    bool json = false;
 };
 
 int usage()
@@ -23,11 +47,41 @@ int usage()
     cerr << "usage:" << endl;
     cerr << " -i | --input-file : input file in grib2 format" << endl;
     cerr << " -o | --output-file : output file for parsed data (- for stdout)" << endl;
-    cerr << " -f | --format txt | svg : output format" << endl;
+    cerr << " -f | --format txt | svg | f32 | f64 | npy | npy-f64 | zarr | grib2 : output format" << endl;
+    cerr << "      grib2 writes decoded messages back, a subset with spatial filter" << endl;
+    cerr << " --precision N | shortest : txt format with N (0 to 17) digits after decimal point," << endl;
+    cerr << "                           or shortest to read same values back" << endl;
+    cerr << " --chunks chunkJ,chunkI : chunks shape for zarr format (default: 256,256)" << endl;
+    cerr << " --codec none | zlib[:level] : chunks codec for zarr format (default: none)" << endl;
+    cerr << " --packing 5.2 | 5.3:1 | 5.3:2 : complex packing for grib2 format (default: 5.3:2)" << endl;
+    cerr << " --group-splitting fast[:length] | compact[:maxLength] : grib2 groups of fixed" << endl;
+    cerr << "      length for speed, or adapted to values for size (default: compact)" << endl;
+    cerr << " --decimal-scale D : grib2 values precision of 10^-D (default: input one)" << endl;
+    cerr << " --derive \"name = expression\" : output derived field instead of components," << endl;
+    cerr << "      can be repeated. Expression uses U, V or P<parameter id> components," << endl;
+    cerr << "      for example \"speed = hypot(U, V) * 1.94384\"" << endl;
+    cerr << " --select key=value,... : decode only messages matching selection, can be" << endl;
+    cerr << "      repeated. Keys: parameter, level (type[:value], for instance 100:85000" << endl;
+    cerr << "      or 103:10), forecast (time with s, m, h or d unit, default h)," << endl;
+    cerr << "      member and statistic" << endl;
     cerr << " --lat-min : minimum latitude in degree" << endl;
     cerr << " --lat-max : maximum latitude in degree" << endl;
     cerr << " --lon-min : minimum longitude in degree" << endl;
     cerr << " --lon-max : maximum longitude in degree" << endl;
+    cerr << " --decimation strideI,strideJ : keep a point every strides" << endl;
+    cerr << " --decimation-mode sample | average : decimation keeps points or boxes average" << endl;
+    cerr << " --region latMin,latMax,lonMin,lonMax : region to extract, can be repeated" << endl;
+    cerr << " --points file : extract values at points, file with a \"lat lon\" by line" << endl;
+    cerr << " --regrid lat1,lat2,latInc,lon1,lon2,lonInc : remap values on a target grid" << endl;
+    cerr << " --interpolation nearest | bilinear : interpolation for points and regrid" << endl;
+    cerr << " --bench N : decode input N times from memory without output, and print" << endl;
+    cerr << "      timings" << endl;
+    cerr << " --json on | off : bench timings in json format" << endl;
+    cerr << " --recovery on | off : skip garbage and truncated messages instead of ending" << endl;
+    cerr << " --log-level none | error | warning : decoding errors printed (default: warning," << endl;
+    cerr << "      with skipped unsupported messages)" << endl;
+    cerr << " --trace file : write decoding timeline in Chrome trace JSON format" << endl;
+    cerr << " --stats on | off : print decoding statistics, if library is built with them" << endl;
 
     return -1;
 }
@@ -41,9 +95,93 @@ int error(const char *msg, const char *msg2 = nullptr)
     return -1;
 }
 
+bool parseRegion(const char *arg, Parameters& params)
+{
+    G2DEC_SpatialFilter region;
+    if (sscanf(arg, "%lf,%lf,%lf,%lf", &region.latMin, &region.latMax,
+               &region.lonMin, &region.lonMax) != 4)
+        return false;
+
+    params.regions.push_back(region);
+    return true;
+}
+
+bool parseSelection(const char *arg, Parameters& params)
+{
+    G2DEC_Selection selection = {G2DEC_PARAMETER_UNKNOWN, -1, -1., -1,
+                                 G2DEC_TIME_UNIT_HOUR, -1, -1};
+    stringstream ss(arg);
+    string item;
+
+    while (getline(ss, item, ',')) {
+        const size_t equal = item.find('=');
+        if (equal == string::npos)
+            return false;
+
+        const string key = item.substr(0, equal);
+        const char *value = item.c_str() + equal + 1;
+        char unit = 'h';
+
+        if (key == "parameter")
+            selection.parameter = static_cast<G2DEC_Parameter>(atoi(value));
+        else if (key == "level") {
+            if (sscanf(value, "%d:%lf", &selection.levelType, &selection.level) < 1)
+                return false;
+        } else if (key == "forecast") {
+            if (sscanf(value, "%d%c", &selection.forecastTime, &unit) < 1)
+                return false;
+            if (unit == 's')
+                selection.timeUnit = G2DEC_TIME_UNIT_SECOND;
+            else if (unit == 'm')
+                selection.timeUnit = G2DEC_TIME_UNIT_MINUTE;
+            else if (unit == 'd')
+                selection.timeUnit = G2DEC_TIME_UNIT_DAY;
+            else if (unit != 'h')
+                return false;
+        } else if (key == "member")
+            selection.member = atoi(value);
+        else if (key == "statistic")
+            selection.statistic = atoi(value);
+        else
+            return false;
+    }
+
+    params.selections.push_back(selection);
+    return true;
+}
+
+bool parsePoints(const char *filename, Parameters& params)
+{
+    ifstream fin(filename);
+    if (!fin.is_open())
+        return false;
+
+    G2DEC_Point point;
+    while (fin >> point.lat >> point.lon)
+        params.points.push_back(point);
+
+    return fin.eof();
+}
+
+bool parseRegrid(const char *arg, Parameters& params)
+{
+    G2DEC_Grid& grid = params.regrid;
+    if (sscanf(arg, "%lf,%lf,%lf,%lf,%lf,%lf", &grid.lat1, &grid.lat2,
+               &grid.latInc, &grid.lon1, &grid.lon2, &grid.lonInc) != 6)
+        return false;
+
+    if (grid.latInc == 0. || grid.lonInc == 0.)
+        return false;
+
+    grid.nj = lround((grid.lat2 - grid.lat1) / grid.latInc) + 1;
+    grid.ni = lround((grid.lon2 - grid.lon1) / grid.lonInc) + 1;
+    return grid.ni > 0 && grid.nj > 0;
+}
+
 bool parseArguments(int argc, char *argv[], Parameters& params)
 {
     memset(&params.filter, 0, sizeof(params.filter));
+    memset(&params.regrid, 0, sizeof(params.regrid));
 
     for (int i = 1; i < argc; i++) {
         string arg = string(argv[i]);
@@ -55,7 +193,66 @@ bool parseArguments(int argc, char *argv[], Parameters& params)
             params.outputFile = argv[++i];
         else if (arg == "-f" || arg == "--format")
             params.outputFormat = argv[++i];
-        else if (arg == "--lat-min")
+        else if (arg == "--precision") {
+            string precision = argv[++i];
+            if (precision == "shortest") {
+                params.outputOptions.textFormat = OutputOptions::SHORTEST;
+            } else {
+                // largest precision useful to to_chars of double
+                const long maxPrecision = 17;
+                char *end;
+                const long digits = strtol(argv[i], &end, 10);
+                if (!isdigit((unsigned char)argv[i][0]) || *end || digits > maxPrecision)
+                    return error("bad precision ", argv[i]), false;
+                params.outputOptions.textFormat = OutputOptions::FIXED;
+                params.outputOptions.precision = digits;
+            }
+        } else if (arg == "--chunks") {
+            if (sscanf(argv[++i], "%d,%d", &params.outputOptions.chunkJ,
+                       &params.outputOptions.chunkI) != 2)
+                return error("bad chunks ", argv[i]), false;
+        } else if (arg == "--codec") {
+            string codec = argv[++i];
+            if (codec == "none")
+                params.outputOptions.compressionLevel = -1;
+            else if (codec == "zlib")
+                params.outputOptions.compressionLevel = 1;
+            else if (codec.compare(0, 5, "zlib:") == 0)
+                params.outputOptions.compressionLevel = atoi(codec.c_str() + 5);
+            else
+                return error("unknown codec ", argv[i]), false;
+        } else if (arg == "--packing") {
+            G2DEC_EncodeOptions& encoding = params.outputOptions.encoding;
+            string packing = argv[++i];
+            if (packing == "5.2")
+                encoding.tpl = 2;
+            else if (packing == "5.3:1" || packing == "5.3:2") {
+                encoding.tpl = 3;
+                encoding.spatialOrder = packing[4] - '0';
+            } else
+                return error("unknown packing ", argv[i]), false;
+        } else if (arg == "--group-splitting") {
+            G2DEC_EncodeOptions& encoding = params.outputOptions.encoding;
+            string splitting = argv[++i];
+            size_t colon = splitting.find(':');
+            if (colon != string::npos)
+                encoding.groupLength = atoi(splitting.c_str() + colon + 1);
+            splitting = splitting.substr(0, colon);
+            if (splitting == "fast")
+                encoding.groupSplitting = G2DEC_GROUP_SPLITTING_FAST;
+            else if (splitting == "compact")
+                encoding.groupSplitting = G2DEC_GROUP_SPLITTING_COMPACT;
+            else
+                return error("unknown group splitting ", argv[i]), false;
+        } else if (arg == "--decimal-scale") {
+            params.outputOptions.decimalScale = atoi(argv[++i]);
+        } else if (arg == "--derive") {
+            Expression expr;
+            string exprError;
+            if (!expr.parse(argv[++i], exprError))
+                return error("bad derived field: ", exprError.c_str()), false;
+            params.outputOptions.derived.push_back(argv[i]);
+        } else if (arg == "--lat-min")
             params.filter.latMin = atof(argv[++i]);
         else if (arg == "--lat-max")
             params.filter.latMax = atof(argv[++i]);
@@ -63,7 +260,61 @@ bool parseArguments(int argc, char *argv[], Parameters& params)
             params.filter.lonMin = atof(argv[++i]);
         else if (arg == "--lon-max")
             params.filter.lonMax = atof(argv[++i]);
-        else
+        else if (arg == "--decimation") {
+            if (sscanf(argv[++i], "%d,%d", &params.decimation.strideI,
+                       &params.decimation.strideJ) != 2)
+                return error("bad decimation ", argv[i]), false;
+        } else if (arg == "--decimation-mode") {
+            string mode = argv[++i];
+            if (mode == "sample")
+                params.decimation.average = 0;
+            else if (mode == "average")
+                params.decimation.average = 1;
+            else
+                return error("unknown decimation mode ", argv[i]), false;
+        } else if (arg == "--region") {
+            if (!parseRegion(argv[++i], params))
+                return error("bad region ", argv[i]), false;
+        } else if (arg == "--select") {
+            if (!parseSelection(argv[++i], params))
+                return error("bad selection ", argv[i]), false;
+        } else if (arg == "--points") {
+            if (!parsePoints(argv[++i], params))
+                return error("cannot read points in ", argv[i]), false;
+        } else if (arg == "--regrid") {
+            if (!parseRegrid(argv[++i], params))
+                return error("bad regrid ", argv[i]), false;
+        } else if (arg == "--interpolation") {
+            string interpolation = argv[++i];
+            if (interpolation == "nearest")
+                params.interpolation = G2DEC_INTERPOLATION_NEAREST;
+            else if (interpolation == "bilinear")
+                params.interpolation = G2DEC_INTERPOLATION_BILINEAR;
+            else
+                return error("unknown interpolation ", argv[i]), false;
+        } else if (arg == "--bench") {
+            params.benchIterations = atoi(argv[++i]);
+            if (params.benchIterations <= 0)
+                return error("bad bench iterations ", argv[i]), false;
+        } else if (arg == "--json") {
+            params.json = string(argv[++i]) == "on";
+        } else if (arg == "--recovery") {
+            params.recovery = string(argv[++i]) == "on";
+        } else if (arg == "--log-level") {
+            string level = argv[++i];
+            if (level == "none")
+                params.logLevel = G2DEC_LOG_NONE;
+            else if (level == "error")
+                params.logLevel = G2DEC_LOG_ERROR;
+            else if (level == "warning")
+                params.logLevel = G2DEC_LOG_WARNING;
+            else
+                return error("unknown log level ", argv[i]), false;
+        } else if (arg == "--trace") {
+            params.traceFile = argv[++i];
+        } else if (arg == "--stats") {
+            params.stats = string(argv[++i]) == "on";
+        } else
             return error("unknown argument ", arg.c_str()), false;
     }
 
@@ -73,9 +324,148 @@ bool parseArguments(int argc, char *argv[], Parameters& params)
     if (!params.outputFile.empty() && params.outputFormat.empty())
         params.outputFormat = "txt";
 
+    // product section has no parameter for derived fields
+    if (params.outputFormat == "grib2" && !params.outputOptions.derived.empty())
+        return error("derived fields cannot be written in grib2 format"), false;
+
     return true;
 }
 
+void printStats(const grib2dec::Grib2Dec& decoder)
+{
+    G2DEC_Stats stats;
+    if (decoder.getStats(stats) != G2DEC_STATUS_OK) {
+        cerr << "statistics not available, build library with GRIB2DEC_STATS" << endl;
+        return;
+    }
+
+    static const char *phases[] = {"headers", "groups", "values", "interpolation"};
+
+    auto print = [](const string& name, const G2DEC_Counter& counter) {
+        fprintf(stderr, "  %-14s %10lld %14lld %12.6f\n", name.c_str(),
+                counter.count, counter.bytes, counter.seconds);
+    };
+
+    fprintf(stderr, "  %-14s %10s %14s %12s\n", "", "count", "bytes", "seconds");
+    for (int i = 0; i < 9; i++)
+        print("section " + to_string(i), stats.sections[i]);
+    for (int i = 0; i < G2DEC_PHASES_NUMBER; i++)
+        print(phases[i], stats.phases[i]);
+
+    fprintf(stderr, "  messages %lld, messages skipped %lld, bytes read %lld, "
+            "values decoded %lld, values skipped %lld, seeks %lld\n",
+            stats.messages, stats.messagesSkipped, stats.bytesRead,
+            stats.valuesDecoded, stats.valuesSkipped, stats.seeks);
+}
+
+void setDecoderOptions(grib2dec::Grib2Dec& decoder, const Parameters& params)
+{
+    decoder.setLogLevel(params.logLevel);
+    decoder.setRecovery(params.recovery);
+    decoder.setSpatialFilter(params.filter);
+    decoder.setDecimation(params.decimation);
+    decoder.setSelections(params.selections.data(), params.selections.size());
+    decoder.setRegions(params.regions.data(), params.regions.size());
+    decoder.setPoints(params.points.data(), params.points.size(),
+                      params.interpolation);
+    decoder.setRegrid(params.regrid, params.interpolation);
+}
+
+long long nbDecodedValues(const G2DEC_Message& message)
+{
+    long long nb = message.valuesLength + message.pointValuesLength;
+    for (int i = 0; i < message.regionsLength; i++)
+        nb += message.regions[i].valuesLength;
+    return nb;
+}
+
+/*
+ * Decode input from memory several times, without output, so that only
+ * decoding is measured.
+ */
+int bench(const Parameters& params)
+{
+    using clock = chrono::steady_clock;
+
+    ifstream fin(params.inputFile, ios_base::in | ios_base::binary);
+    if (!fin.is_open())
+        return error("cannot open ", params.inputFile.c_str());
+
+    const string data((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+
+    Output *output = Output::create("", "");
+    vector<double> messageTimes;
+    long long nbValues = 0;
+
+    const auto begin = clock::now();
+
+    for (int iteration = 0; iteration < params.benchIterations; iteration++) {
+        istringstream input(data);
+        grib2dec::Grib2Dec *decoder = grib2dec::Grib2Dec::create(input);
+        setDecoderOptions(*decoder, params);
+
+        while (true) {
+            G2DEC_Message message;
+            const auto messageBegin = clock::now();
+            auto status = decoder->nextMessage(message);
+            const auto messageEnd = clock::now();
+
+            if (status == G2DEC_STATUS_END)
+                break;
+            else if (status != G2DEC_STATUS_OK)
+                continue;
+
+            messageTimes.push_back(chrono::duration<double>(messageEnd - messageBegin).count());
+            nbValues += nbDecodedValues(message);
+            output->setComponent(message);
+        }
+
+        delete decoder;
+    }
+
+    const double seconds = chrono::duration<double>(clock::now() - begin).count();
+    output->end();
+    delete output;
+
+    const size_t nbMessages = messageTimes.size();
+    if (nbMessages == 0)
+        return error("no message decoded in ", params.inputFile.c_str());
+
+    sort(messageTimes.begin(), messageTimes.end());
+    const double minTime = messageTimes.front();
+    const double medianTime = messageTimes[nbMessages / 2];
+    const double maxTime = messageTimes.back();
+    const double megabytes = double(data.size()) * params.benchIterations / 1e6;
+
+    if (params.json) {
+        string filename;
+        for (char c : params.inputFile) {
+            if (c == '"' || c == '\\')
+                filename += '\\';
+            filename += c;
+        }
+
+        printf("{\"file\": \"%s\", \"iterations\": %d, \"messages\": %zu, "
+               "\"values\": %lld, \"bytes\": %zu, \"seconds\": %.6f, "
+               "\"messagesPerSecond\": %.3f, \"valuesPerSecond\": %.1f, "
+               "\"inputMBPerSecond\": %.3f, \"messageSeconds\": "
+               "{\"min\": %.6f, \"median\": %.6f, \"max\": %.6f}}\n",
+               filename.c_str(), params.benchIterations, nbMessages, nbValues,
+               data.size() * params.benchIterations, seconds,
+               nbMessages / seconds, nbValues / seconds, megabytes / seconds,
+               minTime, medianTime, maxTime);
+    } else {
+        printf("%d iterations, %zu messages, %lld values, %.3f MB in %.3f s\n",
+               params.benchIterations, nbMessages, nbValues, megabytes, seconds);
+        printf("%.1f messages/s, %.0f values/s, %.1f MB/s\n",
+               nbMessages / seconds, nbValues / seconds, megabytes / seconds);
+        printf("message time min / median / max: %.3f / %.3f / %.3f ms\n",
+               minTime * 1e3, medianTime * 1e3, maxTime * 1e3);
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     Parameters params;
@@ -86,15 +476,26 @@ int main(int argc, char *argv[])
     if (!parseArguments(argc, argv, params))
         return -1;
 
+    if (params.benchIterations > 0)
+        return bench(params);
+
     grib2dec::Grib2Dec *decoder =
             grib2dec::Grib2Dec::create(params.inputFile.c_str());
 
     if (!decoder)
         return -1;
 
-    decoder->setSpatialFilter(params.filter);
+    setDecoderOptions(*decoder, params);
 
-    Output *output = Output::create(params.outputFile, params.outputFormat);
+    Output *output = Output::create(params.outputFile, params.outputFormat,
+                                    params.outputOptions);
+    if (!output) {
+        delete decoder;
+        return -1;
+    }
+
+    if (!params.traceFile.empty())
+        grib2dec::startTrace();
 
     int nbMessages = 0;
 
@@ -103,6 +504,29 @@ int main(int argc, char *argv[])
         auto status = decoder->nextMessage(message);
         if (status == G2DEC_STATUS_END)
             break;
+        else if (status == G2DEC_STATUS_OK && message.pointValuesLength) {
+            // points values as a single row
+            G2DEC_Message pointsMessage = message;
+            pointsMessage.grid.ni = message.pointValuesLength;
+            pointsMessage.grid.nj = 1;
+            pointsMessage.values = message.pointValues;
+            pointsMessage.valuesLength = message.pointValuesLength;
+            output->setComponent(pointsMessage);
+            nbMessages++;
+        }
+        else if (status == G2DEC_STATUS_OK && message.regionsLength) {
+            // one component by region
+            for (int i = 0; i < message.regionsLength; i++) {
+                const G2DEC_Region& region = message.regions[i];
+                assert(region.valuesLength == region.grid.ni * region.grid.nj);
+                G2DEC_Message regionMessage = message;
+                regionMessage.grid = region.grid;
+                regionMessage.values = region.values;
+                regionMessage.valuesLength = region.valuesLength;
+                output->setComponent(regionMessage);
+            }
+            nbMessages++;
+        }
         else if (status == G2DEC_STATUS_OK) {
             assert(message.valuesLength == message.grid.ni * message.grid.nj);
             output->setComponent(message);
@@ -112,6 +536,13 @@ int main(int argc, char *argv[])
 
     output->end();
 
+    if (!params.traceFile.empty() &&
+        grib2dec::stopTrace(params.traceFile.c_str()) != G2DEC_STATUS_OK)
+        error("cannot write trace ", params.traceFile.c_str());
+
+    if (params.stats)
+        printStats(*decoder);
+
     delete output;
     delete decoder;
 
@@ -0,0 +1,79 @@
+#include "binary.hpp"
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+using namespace std;
+
+namespace grib2dec_demo {
+
+namespace {
+
+const int blockSize = 1 << 20;
+
+inline uint32_t littleEndian(uint32_t v)
+{
+    if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        return __builtin_bswap32(v);
+    else
+        return v;
+}
+
+inline uint64_t littleEndian(uint64_t v)
+{
+    if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        return __builtin_bswap64(v);
+    else
+        return v;
+}
+
+template <typename T, typename U>
+void convert(const double *values, int nbValues, char *output)
+{
+    static_assert(sizeof(T) == sizeof(U));
+
+    for (int i = 0; i < nbValues; i++) {
+        T v = values[i];
+        U u;
+        memcpy(&u, &v, sizeof(u));
+        u = littleEndian(u);
+        memcpy(output + i * sizeof(u), &u, sizeof(u));
+    }
+}
+
+} // local namespace
+
+Binary::Binary(const string& filename, bool doublePrecision)
+    : Output(filename, ios_base::out | ios_base::binary),
+      doublePrecision(doublePrecision), buffer(blockSize)
+{
+}
+
+void Binary::writeValues(const double *values, int nbValues)
+{
+    const int blockValues = buffer.size() / valueSize();
+
+    for (int begin = 0; begin < nbValues; begin += blockValues) {
+        int nb = min(blockValues, nbValues - begin);
+
+        if (doublePrecision)
+            convert<double, uint64_t>(values + begin, nb, buffer.data());
+        else
+            convert<float, uint32_t>(values + begin, nb, buffer.data());
+
+        out.write(buffer.data(), nb * valueSize());
+    }
+}
+
+const char *Binary::dtype() const
+{
+    return doublePrecision ? "<f8" : "<f4";
+}
+
+int Binary::valueSize() const
+{
+    return doublePrecision ? 8 : 4;
+}
+
+}
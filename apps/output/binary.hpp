@@ -0,0 +1,33 @@
+#ifndef __OUTPUT_BINARY_HPP
+#define __OUTPUT_BINARY_HPP
+
+#include "output.hpp"
+
+#include <vector>
+
+namespace grib2dec_demo {
+
+/*
+ * Base for binary outputs : values written as little-endian float32 or
+ * float64, converted and written by large blocks.
+ */
+class Binary : public Output {
+public:
+    Binary(const std::string& filename, bool doublePrecision);
+
+protected:
+    void writeValues(const double *values, int nbValues);
+
+    // numpy type description: "<f4" or "<f8"
+    const char *dtype() const;
+
+    int valueSize() const;
+
+private:
+    const bool doublePrecision;
+    std::vector<char> buffer;
+};
+
+} // gribdec-demo
+
+#endif
@@ -0,0 +1,127 @@
+#include "derived.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace grib2dec_demo {
+
+namespace {
+
+bool sameGroup(const G2DEC_Message& a, const G2DEC_Message& b)
+{
+    const G2DEC_Datetime& da = a.datetime, & db = b.datetime;
+    const G2DEC_Grid& ga = a.grid, & gb = b.grid;
+    const G2DEC_Product& pa = a.product, & pb = b.product;
+
+    return pa.levelType == pb.levelType && pa.level == pb.level &&
+           pa.forecastTime == pb.forecastTime && pa.timeUnit == pb.timeUnit &&
+           pa.member == pb.member && pa.statistic == pb.statistic &&
+           da.year == db.year && da.month == db.month && da.day == db.day &&
+           da.hour == db.hour && da.minute == db.minute && da.second == db.second &&
+           ga.ni == gb.ni && ga.nj == gb.nj && ga.lat1 == gb.lat1 &&
+           ga.lon1 == gb.lon1 && ga.latInc == gb.latInc && ga.lonInc == gb.lonInc;
+}
+
+} // local namespace
+
+Derived::Derived(Output *output, const vector<Expression>& expressions)
+    : output(output), expressions(expressions),
+      results(expressions.size())
+{
+}
+
+Derived::~Derived()
+{
+    delete output;
+}
+
+void Derived::setComponent(const G2DEC_Message& message)
+{
+    if (!needed(message.parameter))
+        return;
+
+    // first group of same datetime and grid still waiting this component
+    auto group = find_if(groups.begin(), groups.end(), [&](const Group& g) {
+        return sameGroup(g.message, message) &&
+               !g.components.count(message.parameter);
+    });
+
+    if (group == groups.end()) {
+        groups.emplace_back();
+        group = prev(groups.end());
+        group->message = message;
+    }
+
+    group->components[message.parameter].assign(
+            message.values, message.values + message.valuesLength);
+
+    if (complete(*group)) {
+        evaluate(*group);
+        groups.erase(group);
+    }
+}
+
+void Derived::end()
+{
+    if (!groups.empty())
+        cerr << groups.size() << " incomplete components group(s) for derived fields" << endl;
+
+    output->end();
+}
+
+bool Derived::needed(int parameter) const
+{
+    for (const auto& expr : expressions) {
+        const auto& params = expr.parameters();
+        if (find(params.begin(), params.end(), parameter) != params.end())
+            return true;
+    }
+    return false;
+}
+
+bool Derived::complete(const Group& group) const
+{
+    for (const auto& expr : expressions) {
+        for (int param : expr.parameters()) {
+            if (!group.components.count(param))
+                return false;
+        }
+    }
+    return true;
+}
+
+void Derived::evaluate(const Group& group)
+{
+    const int nbValues = group.message.valuesLength;
+
+    // inputs of each expression
+    vector<vector<const double*>> inputs(expressions.size());
+
+    for (size_t e = 0; e < expressions.size(); e++) {
+        for (int param : expressions[e].parameters())
+            inputs[e].push_back(group.components.at(param).data());
+        results[e].resize(nbValues);
+    }
+
+    // single pass over components, by blocks
+    for (int offset = 0; offset < nbValues; offset += Expression::blockSize) {
+        int n = min(Expression::blockSize, nbValues - offset);
+        for (size_t e = 0; e < expressions.size(); e++)
+            expressions[e].evaluate(inputs[e].data(), offset, n,
+                                    results[e].data() + offset);
+    }
+
+    for (size_t e = 0; e < expressions.size(); e++) {
+        G2DEC_Message message = group.message;
+        message.category = G2DEC_CATEGORY_UNKNOWN;
+        message.parameter = G2DEC_PARAMETER_UNKNOWN;
+        message.values = results[e].data();
+        message.valuesLength = nbValues;
+        output->setFieldName(expressions[e].name());
+        output->setComponent(message);
+    }
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef __OUTPUT_DERIVED_HPP
+#define __OUTPUT_DERIVED_HPP
+
+#include "expression.hpp"
+#include "output.hpp"
+
+#include <list>
+#include <map>
+#include <vector>
+
+namespace grib2dec_demo {
+
+/*
+ * Derived fields output : messages with same datetime and grid are
+ * matched until all parameters used by expressions are received. Then
+ * expressions are evaluated in a single pass over the components, and
+ * only derived fields are given to the wrapped output, in expressions
+ * order. Parameter of derived fields is unknown, they are named by the
+ * field name of their expression.
+ */
+class Derived : public Output {
+public:
+    // expressions are parsed ones, see Output::create()
+    Derived(Output *output, const std::vector<Expression>& expressions);
+    ~Derived();
+
+    void setComponent(const G2DEC_Message& message);
+    void end();
+
+private:
+    struct Group {
+        G2DEC_Message message;
+        std::map<int, std::vector<double>> components;
+    };
+
+    bool needed(int parameter) const;
+    bool complete(const Group& group) const;
+    void evaluate(const Group& group);
+
+    Output *output;
+    std::vector<Expression> expressions;
+    std::list<Group> groups;
+    std::vector<std::vector<double>> results;
+};
+
+} // gribdec-demo
+
+#endif
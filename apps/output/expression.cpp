@@ -0,0 +1,366 @@
+#include "expression.hpp"
+
+#include "grib2dec/types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctype.h>
+#include <stdexcept>
+#include <stdlib.h>
+
+using namespace std;
+
+namespace grib2dec_demo {
+
+/*
+ * Recursive descent parser:
+ *   expr    := term (('+' | '-') term)*
+ *   term    := unary (('*' | '/') unary)*
+ *   unary   := '-' unary | power
+ *   power   := primary ('^' unary)?
+ *   primary := number | variable | function '(' args ')' | '(' expr ')'
+ */
+class Expression::Parser {
+public:
+    Parser(Expression& expr, const string& text) : expr(expr), text(text) {}
+
+    void parse() {
+        expression();
+        skipSpaces();
+        if (pos < text.size())
+            throw runtime_error("unexpected '" + text.substr(pos) + "'");
+    }
+
+private:
+    void expression() {
+        term();
+        while (true) {
+            if (accept('+')) {
+                term();
+                emit(ADD);
+            } else if (accept('-')) {
+                term();
+                emit(SUB);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void term() {
+        unary();
+        while (true) {
+            if (accept('*')) {
+                unary();
+                emit(MUL);
+            } else if (accept('/')) {
+                unary();
+                emit(DIV);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void unary() {
+        if (accept('-')) {
+            unary();
+            emit(NEG);
+        } else {
+            power();
+        }
+    }
+
+    void power() {
+        primary();
+        if (accept('^')) {
+            unary();
+            emit(POW);
+        }
+    }
+
+    void primary() {
+        skipSpaces();
+
+        if (accept('(')) {
+            expression();
+            expect(')');
+            return;
+        }
+
+        if (pos < text.size() && (isdigit(text[pos]) || text[pos] == '.')) {
+            const char *begin = text.c_str() + pos;
+            char *end;
+            double value = strtod(begin, &end);
+            pos += end - begin;
+            emit(CONST, value);
+            return;
+        }
+
+        string name = identifier();
+        if (name.empty())
+            throw runtime_error("value expected at '" + text.substr(pos) + "'");
+
+        if (accept('('))
+            return function(name);
+
+        if (name == "pi")
+            return emit(CONST, M_PI);
+
+        variable(name);
+    }
+
+    void function(const string& name) {
+        static const struct {
+            const char *name;
+            OpCode op;
+            int nbArgs;
+        } functions[] = {
+            {"sqrt", SQRT, 1}, {"abs", ABS, 1}, {"exp", EXP, 1},
+            {"log", LOG, 1}, {"sin", SIN, 1}, {"cos", COS, 1},
+            {"tan", TAN, 1}, {"atan", ATAN, 1}, {"hypot", HYPOT, 2},
+            {"atan2", ATAN2, 2}, {"min", MIN, 2}, {"max", MAX, 2},
+            {"pow", POW, 2},
+        };
+
+        for (const auto& f : functions) {
+            if (name != f.name)
+                continue;
+
+            for (int i = 0; i < f.nbArgs; i++) {
+                if (i > 0)
+                    expect(',');
+                expression();
+            }
+            expect(')');
+            return emit(f.op);
+        }
+
+        throw runtime_error("unknown function " + name);
+    }
+
+    void variable(const string& name) {
+        int param;
+        if (name == "U")
+            param = G2DEC_PARAMETER_WIND_U;
+        else if (name == "V")
+            param = G2DEC_PARAMETER_WIND_V;
+        else if (name.size() > 1 && name[0] == 'P' &&
+                 all_of(name.begin() + 1, name.end(), ::isdigit))
+            param = atoi(name.c_str() + 1);
+        else
+            throw runtime_error("unknown variable " + name);
+
+        auto it = find(expr.params.begin(), expr.params.end(), param);
+        int var = it - expr.params.begin();
+        if (it == expr.params.end())
+            expr.params.push_back(param);
+
+        emit(VAR, 0., var);
+    }
+
+    string identifier() {
+        skipSpaces();
+        size_t begin = pos;
+        while (pos < text.size() && (isalnum(text[pos]) || text[pos] == '_'))
+            pos++;
+        return text.substr(begin, pos - begin);
+    }
+
+    void emit(OpCode op, double value = 0., int var = 0) {
+        expr.program.push_back({op, value, var});
+
+        // stack size
+        switch (op) {
+        case CONST:
+        case VAR:
+            depth++;
+            break;
+        case ADD: case SUB: case MUL: case DIV: case POW:
+        case HYPOT: case ATAN2: case MIN: case MAX:
+            depth--;
+            break;
+        default:
+            break;
+        }
+
+        expr.stackSize = max(expr.stackSize, depth);
+    }
+
+    bool accept(char c) {
+        skipSpaces();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!accept(c))
+            throw runtime_error(string("'") + c + "' expected");
+    }
+
+    void skipSpaces() {
+        while (pos < text.size() && isspace(text[pos]))
+            pos++;
+    }
+
+    Expression& expr;
+    const string& text;
+    size_t pos = 0;
+    int depth = 0;
+};
+
+namespace {
+
+template <typename F>
+inline void unary(double *r, int n, F f)
+{
+    for (int i = 0; i < n; i++)
+        r[i] = f(r[i]);
+}
+
+template <typename F>
+inline void binary(double *a, const double *b, int n, F f)
+{
+    for (int i = 0; i < n; i++)
+        a[i] = f(a[i], b[i]);
+}
+
+} // local namespace
+
+bool Expression::parse(const string& definition, string& error)
+{
+    fieldName.clear();
+    params.clear();
+    program.clear();
+    stackSize = 0;
+
+    size_t equal = definition.find('=');
+    if (equal == string::npos) {
+        error = "expression must be name = expression";
+        return false;
+    }
+
+    fieldName = definition.substr(0, equal);
+    fieldName.erase(remove_if(fieldName.begin(), fieldName.end(), ::isspace),
+                    fieldName.end());
+
+    if (fieldName.empty()) {
+        error = "field name is empty";
+        return false;
+    }
+
+    // written in json metadata of outputs
+    if (!all_of(fieldName.begin(), fieldName.end(),
+                [](char c) { return isalnum((unsigned char)c) || c == '_'; })) {
+        error = "field name must have only letters, digits and _";
+        return false;
+    }
+
+    const string text = definition.substr(equal + 1);
+
+    try {
+        Parser(*this, text).parse();
+    } catch (const runtime_error& e) {
+        error = e.what();
+        return false;
+    }
+
+    if (program.empty()) {
+        error = "expression is empty";
+        return false;
+    }
+
+    return true;
+}
+
+void Expression::evaluate(const double *const *inputs, int offset,
+                          int nbValues, double *output) const
+{
+    thread_local vector<double> stack;
+    stack.resize(max<size_t>(stack.size(), size_t(stackSize) * blockSize));
+
+    const int n = nbValues;
+    int top = -1;
+    auto at = [&](int k) { return stack.data() + k * blockSize; };
+
+    for (const Instruction& ins : program) {
+        switch (ins.op) {
+        case CONST:
+            fill_n(at(++top), n, ins.value);
+            break;
+        case VAR:
+            copy_n(inputs[ins.var] + offset, n, at(++top));
+            break;
+        case NEG:
+            unary(at(top), n, [](double a) { return -a; });
+            break;
+        case SQRT:
+            unary(at(top), n, [](double a) { return sqrt(a); });
+            break;
+        case ABS:
+            unary(at(top), n, [](double a) { return fabs(a); });
+            break;
+        case EXP:
+            unary(at(top), n, [](double a) { return exp(a); });
+            break;
+        case LOG:
+            unary(at(top), n, [](double a) { return log(a); });
+            break;
+        case SIN:
+            unary(at(top), n, [](double a) { return sin(a); });
+            break;
+        case COS:
+            unary(at(top), n, [](double a) { return cos(a); });
+            break;
+        case TAN:
+            unary(at(top), n, [](double a) { return tan(a); });
+            break;
+        case ATAN:
+            unary(at(top), n, [](double a) { return atan(a); });
+            break;
+        case ADD:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return a + b; });
+            break;
+        case SUB:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return a - b; });
+            break;
+        case MUL:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return a * b; });
+            break;
+        case DIV:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return a / b; });
+            break;
+        case POW:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return pow(a, b); });
+            break;
+        case HYPOT:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return sqrt(a * a + b * b); });
+            break;
+        case ATAN2:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return atan2(a, b); });
+            break;
+        case MIN:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return a < b ? a : b; });
+            break;
+        case MAX:
+            top--;
+            binary(at(top), at(top + 1), n, [](double a, double b) { return a > b ? a : b; });
+            break;
+        }
+    }
+
+    copy_n(at(0), n, output);
+}
+
+}
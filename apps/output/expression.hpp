@@ -0,0 +1,68 @@
+#ifndef __OUTPUT_EXPRESSION_HPP
+#define __OUTPUT_EXPRESSION_HPP
+
+#include <string>
+#include <vector>
+
+namespace grib2dec_demo {
+
+/*
+ * Expression over decoded parameters, as "name = expression".
+ *
+ * Variables are parameters: U and V for wind components, or P<id> for
+ * parameter id (see G2DEC_Parameter). Operators + - * / ^, functions
+ * sqrt, abs, exp, log, sin, cos, tan, atan, hypot, atan2, min, max, pow
+ * and constant pi are available.
+ *
+ * Expression is compiled to a stack program, evaluated by blocks of
+ * values: each instruction is a simple loop over a block.
+ */
+class Expression {
+public:
+    static constexpr int blockSize = 256;
+
+    /**
+     * Parse definition, returns false and sets error if not valid.
+     */
+    bool parse(const std::string& definition, std::string& error);
+
+    const std::string& name() const {
+        return fieldName;
+    }
+
+    // parameters used, in inputs order
+    const std::vector<int>& parameters() const {
+        return params;
+    }
+
+    /**
+     * Evaluate nbValues values (<= blockSize), beginning at offset in
+     * inputs. inputs have a values array by parameter.
+     */
+    void evaluate(const double *const *inputs, int offset, int nbValues,
+                  double *output) const;
+
+private:
+    enum OpCode {
+        CONST, VAR, NEG, ADD, SUB, MUL, DIV, POW,
+        SQRT, ABS, EXP, LOG, SIN, COS, TAN, ATAN,
+        HYPOT, ATAN2, MIN, MAX,
+    };
+
+    struct Instruction {
+        OpCode op;
+        double value;  // CONST
+        int var;       // VAR
+    };
+
+    class Parser;
+
+    std::string fieldName;
+    std::vector<int> params;
+    std::vector<Instruction> program;
+    int stackSize = 0;
+};
+
+} // gribdec-demo
+
+#endif
@@ -0,0 +1,40 @@
+#include "grib2.hpp"
+
+#include <grib2dec/grib2dec.hpp>
+
+#include <iostream>
+
+using namespace std;
+
+namespace grib2dec_demo {
+
+Grib2::Grib2(const string& filename, const OutputOptions& options)
+    : Output(filename, ios_base::out | ios_base::binary),
+      encodeOptions(options.encoding),
+      decimalScale(options.decimalScale)
+{
+}
+
+void Grib2::setComponent(const G2DEC_Message& message)
+{
+    // input precision by default
+    encodeOptions.decimalScale = decimalScale >= 0 ? decimalScale
+                                                   : message.decimalScale;
+
+    if (grib2dec::encode(message, encodeOptions, out) == G2DEC_STATUS_OK)
+        nbMessages++;
+    else
+        nbErrors++;
+}
+
+void Grib2::end()
+{
+    out.flush();
+
+    cerr << "grib2: " << nbMessages << " messages written";
+    if (nbErrors)
+        cerr << ", " << nbErrors << " messages cannot be encoded";
+    cerr << endl;
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef __OUTPUT_GRIB2_HPP
+#define __OUTPUT_GRIB2_HPP
+
+#include "output.hpp"
+
+namespace grib2dec_demo {
+
+/*
+ * Grib2 output : each component is encoded back in a grib2 message, with
+ * complex packing. With a spatial filter, output is a subset of input.
+ */
+class Grib2 : public Output {
+public:
+    Grib2(const std::string& filename, const OutputOptions& options);
+
+    void setComponent(const G2DEC_Message& message);
+    void end();
+
+private:
+    G2DEC_EncodeOptions encodeOptions;
+    int decimalScale;
+    int nbMessages = 0;
+    int nbErrors = 0;
+};
+
+} // gribdec-demo
+
+#endif
@@ -0,0 +1,69 @@
+#include "npy.hpp"
+
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace grib2dec_demo {
+
+namespace {
+
+// magic, version, header len and dictionary
+const int headerSize = 128;
+
+} // local namespace
+
+Npy::Npy(const string& filename, bool doublePrecision)
+    : Binary(filename, doublePrecision)
+{
+    // reserved until shape is known
+    writeHeader();
+}
+
+void Npy::setComponent(const G2DEC_Message& message)
+{
+    if (nbMessages == 0) {
+        ni = message.grid.ni;
+        nj = message.grid.nj;
+    } else if (message.grid.ni != ni || message.grid.nj != nj) {
+        cerr << "npy: message skipped, grid size differs from first message" << endl;
+        return;
+    }
+
+    writeValues(message.values, message.valuesLength);
+    nbMessages++;
+}
+
+void Npy::end()
+{
+    if (!out.seekp(0))
+        cerr << "npy: output must be a file" << endl;
+    else
+        writeHeader();
+
+    out.flush();
+}
+
+void Npy::writeHeader()
+{
+    ostringstream dict;
+    dict << "{'descr': '" << dtype() << "', 'fortran_order': False, 'shape': ("
+         << nbMessages << ", " << nj << ", " << ni << "), }";
+
+    string header = "\x93NUMPY";
+    header += char(1);
+    header += char(0);
+
+    const int dictLen = headerSize - header.size() - 2;
+    header += char(dictLen & 0xff);
+    header += char(dictLen >> 8);
+
+    string dictStr = dict.str();
+    dictStr.resize(dictLen - 1, ' ');
+    header += dictStr + "\n";
+
+    out.write(header.data(), header.size());
+}
+
+}
@@ -0,0 +1,29 @@
+#ifndef __OUTPUT_NPY_HPP
+#define __OUTPUT_NPY_HPP
+
+#include "binary.hpp"
+
+namespace grib2dec_demo {
+
+/*
+ * NumPy .npy output : messages are stacked in an array of shape
+ * (messages, nj, ni). All messages must have the same grid size, and
+ * output must be a file as header is written at end.
+ */
+class Npy : public Binary {
+public:
+    Npy(const std::string& filename, bool doublePrecision);
+
+    void setComponent(const G2DEC_Message& message);
+    void end();
+
+private:
+    void writeHeader();
+
+    int nbMessages = 0;
+    int ni = 0, nj = 0;
+};
+
+} // gribdec-demo
+
+#endif
@@ -1,6 +1,11 @@
 #include "output.hpp"
+#include "derived.hpp"
+#include "grib2.hpp"
+#include "npy.hpp"
+#include "raw.hpp"
 #include "svg.hpp"
 #include "txt.hpp"
+#include "zarr.hpp"
 
 #include <iostream>
 
@@ -24,22 +29,48 @@ Output::Output()
 {
 }
 
-Output::Output(const string& filename)
+Output::Output(const string& filename, ios_base::openmode mode)
     : out(filename.empty() || filename == "-" ? cout : fileOut)
 {
     if (!filename.empty() && filename != "-")
-        fileOut.open(filename);
+        fileOut.open(filename, mode);
 }
 
-Output *Output::create(const std::string& filename, const std::string& format)
+Output *Output::create(const std::string& filename, const std::string& format,
+                       const OutputOptions& options)
 {
+    if (!options.derived.empty()) {
+        // derived fields are evaluated only from valid expressions
+        vector<Expression> expressions(options.derived.size());
+        for (size_t i = 0; i < expressions.size(); i++) {
+            string error;
+            if (!expressions[i].parse(options.derived[i], error)) {
+                cerr << "derived field " << options.derived[i] << ": " << error << endl;
+                return nullptr;
+            }
+        }
+
+        OutputOptions outputOptions = options;
+        outputOptions.derived.clear();
+        return new Derived(create(filename, format, outputOptions),
+                           expressions);
+    }
+
     if (filename.empty() && format.empty())
         return new NullOutput();
     else if (format == "svg")
         return new Svg(filename);
+    else if (format == "f32" || format == "f64")
+        return new Raw(filename, format == "f64");
+    else if (format == "npy" || format == "npy-f64")
+        return new Npy(filename, format == "npy-f64");
+    else if (format == "zarr")
+        return new Zarr(filename, options);
+    else if (format == "grib2")
+        return new Grib2(filename, options);
     else
         // txt by default
-        return new Txt(filename);
+        return new Txt(filename, options.textFormat, options.precision);
 }
 
 }
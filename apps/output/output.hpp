@@ -5,24 +5,57 @@
 
 #include <fstream>
 #include <ostream>
+#include <string>
+#include <vector>
 
 namespace grib2dec_demo {
 
+struct OutputOptions {
+    // text values format, general is the same as iostream default
+    enum TextFormat {
+        GENERAL, SHORTEST, FIXED
+    };
+
+    TextFormat textFormat = GENERAL;
+    int precision = 6;
+
+    // zarr chunks shape, and zlib level (< 0 for no compression)
+    int chunkI = 256;
+    int chunkJ = 256;
+    int compressionLevel = -1;
+
+    // derived fields definitions, see Expression
+    std::vector<std::string> derived;
+
+    // grib2 encoding, decimal scale < 0 keeps input precision
+    G2DEC_EncodeOptions encoding = {3, 2, 0, G2DEC_GROUP_SPLITTING_COMPACT, 0};
+    int decimalScale = -1;
+};
+
 class Output {
 public:
     Output();
-    Output(const std::string& filename);
+    Output(const std::string& filename,
+           std::ios_base::openmode mode = std::ios_base::out);
 
     virtual void setComponent(const G2DEC_Message& message) = 0;
     virtual void end() = 0;
 
+    // name of next components, set for derived fields
+    void setFieldName(const std::string& name) {
+        fieldName = name;
+    }
+
     virtual ~Output() {}
 
+    // nullptr if a derived field expression is not valid
     static Output *create(const std::string& filename,
-                          const std::string& format);
+                          const std::string& format,
+                          const OutputOptions& options = OutputOptions());
 
 protected:
     std::ostream& out;
+    std::string fieldName;
 
 private:
     std::ofstream fileOut;
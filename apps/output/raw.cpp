@@ -0,0 +1,69 @@
+#include "raw.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+namespace grib2dec_demo {
+
+Raw::Raw(const string& filename, bool doublePrecision)
+    : Binary(filename, doublePrecision)
+{
+    if (!filename.empty() && filename != "-")
+        sidecarFilename = filename + ".json";
+
+    messages << setprecision(10);
+}
+
+void Raw::setComponent(const G2DEC_Message& message)
+{
+    const G2DEC_Grid& grid = message.grid;
+    const G2DEC_Datetime& dt = message.datetime;
+
+    if (nbMessages++)
+        messages << ",";
+
+    messages << "\n    {\"offset\": " << offset
+             << ", \"discipline\": " << message.discipline
+             << ", \"category\": " << message.category
+             << ", \"parameter\": " << message.parameter;
+
+    if (!fieldName.empty())
+        messages << ", \"name\": \"" << fieldName << "\"";
+
+    messages << ", \"datetime\": \"" << setfill('0')
+             << setw(4) << dt.year << "-" << setw(2) << dt.month << "-"
+             << setw(2) << dt.day << "T" << setw(2) << dt.hour << ":"
+             << setw(2) << dt.minute << ":" << setw(2) << dt.second << "\""
+             << setfill(' ')
+             << ", \"levelType\": " << message.product.levelType
+             << ", \"level\": " << message.product.level
+             << ", \"forecastTime\": " << message.product.forecastTime
+             << ", \"timeUnit\": " << message.product.timeUnit
+             << ",\n     \"ni\": " << grid.ni << ", \"nj\": " << grid.nj
+             << ", \"lat1\": " << grid.lat1 << ", \"lat2\": " << grid.lat2
+             << ", \"latInc\": " << grid.latInc
+             << ", \"lon1\": " << grid.lon1 << ", \"lon2\": " << grid.lon2
+             << ", \"lonInc\": " << grid.lonInc << "}";
+
+    writeValues(message.values, message.valuesLength);
+    offset += size_t(message.valuesLength) * valueSize();
+}
+
+void Raw::end()
+{
+    out.flush();
+
+    if (sidecarFilename.empty())
+        return;
+
+    ofstream sidecar(sidecarFilename);
+    sidecar << "{\n  \"dtype\": \"" << dtype() << "\",\n"
+            << "  \"messages\": [" << messages.str() << "\n  ]\n}\n";
+
+    if (!sidecar)
+        cerr << "cannot write " << sidecarFilename << endl;
+}
+
+}
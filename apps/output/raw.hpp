@@ -0,0 +1,30 @@
+#ifndef __OUTPUT_RAW_HPP
+#define __OUTPUT_RAW_HPP
+
+#include "binary.hpp"
+
+#include <sstream>
+
+namespace grib2dec_demo {
+
+/*
+ * Raw binary output : values of all messages are concatenated, and
+ * messages are described in a json sidecar file (<filename>.json).
+ */
+class Raw : public Binary {
+public:
+    Raw(const std::string& filename, bool doublePrecision);
+
+    void setComponent(const G2DEC_Message& message);
+    void end();
+
+private:
+    std::string sidecarFilename;
+    std::ostringstream messages;
+    size_t offset = 0;
+    int nbMessages = 0;
+};
+
+} // gribdec-demo
+
+#endif
@@ -1,32 +1,138 @@
 #include "txt.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
 using namespace std;
 
 namespace grib2dec_demo {
 
-Txt::Txt(const string& filename) : Output(filename)
+namespace {
+
+// minimum number of values by thread
+const int minValuesByThread = 1 << 16;
+
+/*
+ * Format rows in buffer, each value followed by a space and each row
+ * by a new line. Returns the length of formatted text.
+ */
+size_t formatRows(const double *values, int ni, int nbRows,
+                  OutputOptions::TextFormat format, int precision,
+                  vector<char>& buffer)
+{
+    size_t len = 0;
+
+    // new lines of empty rows
+    if (buffer.size() < size_t(nbRows))
+        buffer.resize(nbRows);
+
+    for (int j = 0; j < nbRows; j++) {
+        for (int i = 0; i < ni; i++, values++) {
+            while (true) {
+                char *first = buffer.data() + len;
+                char *last = buffer.data() + buffer.size();
+
+                // keep room for separators
+                char *end = max(first, last - 2);
+                to_chars_result result;
+
+                switch (format) {
+                case OutputOptions::SHORTEST:
+                    result = to_chars(first, end, *values);
+                    break;
+                case OutputOptions::FIXED:
+                    result = to_chars(first, end, *values, chars_format::fixed, precision);
+                    break;
+                default:
+                    result = to_chars(first, end, *values, chars_format::general, precision);
+                    break;
+                }
+
+                if (result.ec == errc() && last - first > 2) {
+                    *result.ptr = ' ';
+                    len = result.ptr + 1 - buffer.data();
+                    break;
+                }
+
+                buffer.resize(max<size_t>(buffer.size() * 2, 1 << 16));
+            }
+        }
+
+        buffer[len++] = '\n';
+    }
+
+    return len;
+}
+
+} // local namespace
+
+Txt::Txt(const string& filename, OutputOptions::TextFormat format,
+         int precision)
+    : Output(filename), format(format), precision(precision)
 {
 }
 
 void Txt::setComponent(const G2DEC_Message& message)
 {
+    auto start = chrono::steady_clock::now();
     const G2DEC_Grid& grid = message.grid;
 
-    out << "Parameter id: " << message.parameter << endl;
+    if (!fieldName.empty())
+        out << "Name: " << fieldName << "\n";
+    out << "Parameter id: " << message.parameter << "\n";
     out << "Latitude: [" << grid.lat1 << ", " << grid.lat2 << ", " << grid.latInc << "]"
         << ", Longitude: [" << grid.lon1 << ", " << grid.lon2 << ", " << grid.lonInc << "]"
-        << endl;
+        << "\n";
+
+    // rows chunks by thread
+    int nbThreads = min<int>(thread::hardware_concurrency(),
+                             message.valuesLength / minValuesByThread);
+    nbThreads = max(min(nbThreads, grid.nj), 1);
+
+    const int rowsByThread = (grid.nj + nbThreads - 1) / nbThreads;
+
+    if (int(buffers.size()) < nbThreads)
+        buffers.resize(nbThreads);
+
+    vector<size_t> lens(nbThreads);
+
+    auto formatChunk = [&](int t) {
+        int beginRow = min(grid.nj, t * rowsByThread);
+        int endRow = min(grid.nj, beginRow + rowsByThread);
+        lens[t] = formatRows(message.values + size_t(beginRow) * grid.ni,
+                             grid.ni, endRow - beginRow, format, precision,
+                             buffers[t]);
+    };
 
-    int n = 0;
-    for (int j = 0; j < grid.nj; j++) {
-        for (int i = 0; i < grid.ni; i++)
-            out << message.values[n++] << " ";
-        out << endl;
+    vector<thread> threads;
+    for (int t = 1; t < nbThreads; t++)
+        threads.emplace_back(formatChunk, t);
+
+    formatChunk(0);
+
+    for (auto& t : threads)
+        t.join();
+
+    // write in order
+    for (int t = 0; t < nbThreads; t++) {
+        out.write(buffers[t].data(), lens[t]);
+        bytes += lens[t];
     }
+
+    seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
 }
 
 void Txt::end()
 {
+    out.flush();
+
+    if (seconds > 0.) {
+        cerr << "txt: " << bytes / 1e6 << " MB written in " << seconds << " s ("
+             << bytes / 1e6 / seconds << " MB/s)" << endl;
+    }
 }
 
 }
@@ -3,14 +3,37 @@
 
 #include "output.hpp"
 
+#include <vector>
+
 namespace grib2dec_demo {
 
+/*
+ * Text output : values are formatted in reusable buffers, by rows chunks
+ * in parallel, then written in order.
+ *
+ * Values format is general with precision significant digits, shortest
+ * representation to read the same value back, or fixed with precision
+ * digits after decimal point.
+ */
 class Txt : public Output {
 public:
-    Txt(const std::string& filename);
+    Txt(const std::string& filename,
+        OutputOptions::TextFormat format = OutputOptions::GENERAL,
+        int precision = 6);
 
     void setComponent(const G2DEC_Message& message);
     void end();
+
+private:
+    const OutputOptions::TextFormat format;
+    const int precision;
+
+    // buffers by thread, reused between messages
+    std::vector<std::vector<char>> buffers;
+
+    // throughput
+    size_t bytes = 0;
+    double seconds = 0.;
 };
 
 } // gribdec-demo
@@ -0,0 +1,251 @@
+#include "zarr.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+
+#ifdef GRIB2DEC_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+namespace grib2dec_demo {
+
+struct Zarr::Field {
+    string path;
+    int ni, nj;
+    vector<float> values;
+};
+
+namespace {
+
+// maximum tasks waiting, to bound memory used by decoded fields
+const int maxPendingByWorker = 64;
+
+bool writeFile(const string& filename, const void *data, size_t len)
+{
+    ofstream file(filename, ios_base::out | ios_base::binary);
+    file.write(static_cast<const char*>(data), len);
+    if (!file) {
+        cerr << "zarr: cannot write " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+bool writeFile(const string& filename, const string& text)
+{
+    return writeFile(filename, text.data(), text.size());
+}
+
+} // local namespace
+
+Zarr::Zarr(const string& path, const OutputOptions& options)
+    : path(path.empty() || path == "-" ? "grib2dec.zarr" : path),
+      chunkI(max(options.chunkI, 1)), chunkJ(max(options.chunkJ, 1)),
+      compressionLevel(options.compressionLevel)
+{
+#ifndef GRIB2DEC_ZLIB
+    if (compressionLevel >= 0)
+        cerr << "zarr: zlib not available, chunks are not compressed" << endl;
+#endif
+
+    error_code ec;
+    filesystem::create_directories(this->path, ec);
+    if (ec)
+        cerr << "zarr: cannot create " << this->path << ": " << ec.message() << endl;
+
+    writeFile(this->path + "/.zgroup", "{\n    \"zarr_format\": 2\n}\n");
+
+    int nbWorkers = max<int>(thread::hardware_concurrency(), 1);
+    for (int i = 0; i < nbWorkers; i++)
+        workers.emplace_back(&Zarr::work, this);
+}
+
+Zarr::~Zarr()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+
+    taskAdded.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void Zarr::setComponent(const G2DEC_Message& message)
+{
+    const G2DEC_Grid& grid = message.grid;
+    const G2DEC_Datetime& dt = message.datetime;
+
+    auto field = make_shared<Field>();
+    field->path = path + "/field_" + to_string(nbFields++);
+    field->ni = grid.ni;
+    field->nj = grid.nj;
+    field->values.assign(message.values, message.values + message.valuesLength);
+
+    error_code ec;
+    filesystem::create_directories(field->path, ec);
+
+    // array metadata
+    bool compressed = compressionLevel >= 0;
+#ifndef GRIB2DEC_ZLIB
+    compressed = false;
+#endif
+
+    ostringstream zarray;
+    zarray << "{\n"
+           << "    \"zarr_format\": 2,\n"
+           << "    \"shape\": [" << grid.nj << ", " << grid.ni << "],\n"
+           << "    \"chunks\": [" << chunkJ << ", " << chunkI << "],\n"
+           << "    \"dtype\": \"<f4\",\n";
+
+    if (compressed)
+        zarray << "    \"compressor\": {\"id\": \"zlib\", \"level\": " << compressionLevel << "},\n";
+    else
+        zarray << "    \"compressor\": null,\n";
+
+    zarray << "    \"fill_value\": \"NaN\",\n"
+           << "    \"order\": \"C\",\n"
+           << "    \"filters\": null\n"
+           << "}\n";
+
+    writeFile(field->path + "/.zarray", zarray.str());
+
+    ostringstream zattrs;
+    zattrs << setprecision(10) << "{\n"
+           << "    \"discipline\": " << message.discipline << ",\n"
+           << "    \"category\": " << message.category << ",\n"
+           << "    \"parameter\": " << message.parameter << ",\n";
+
+    if (!fieldName.empty())
+        zattrs << "    \"name\": \"" << fieldName << "\",\n";
+
+    zattrs << "    \"datetime\": \"" << setfill('0')
+           << setw(4) << dt.year << "-" << setw(2) << dt.month << "-"
+           << setw(2) << dt.day << "T" << setw(2) << dt.hour << ":"
+           << setw(2) << dt.minute << ":" << setw(2) << dt.second << "\",\n"
+           << setfill(' ')
+           << "    \"lat1\": " << grid.lat1 << ",\n"
+           << "    \"lat2\": " << grid.lat2 << ",\n"
+           << "    \"latInc\": " << grid.latInc << ",\n"
+           << "    \"lon1\": " << grid.lon1 << ",\n"
+           << "    \"lon2\": " << grid.lon2 << ",\n"
+           << "    \"lonInc\": " << grid.lonInc << "\n"
+           << "}\n";
+
+    writeFile(field->path + "/.zattrs", zattrs.str());
+
+    // a task by row of chunks
+    for (int cj = 0; cj * chunkJ < grid.nj; cj++) {
+        submit([this, field, cj]() {
+            vector<float> chunk;
+            vector<unsigned char> encoded;
+            for (int ci = 0; ci * chunkI < field->ni; ci++)
+                encodeChunk(*field, cj, ci, chunk, encoded);
+        });
+    }
+}
+
+void Zarr::end()
+{
+    unique_lock<std::mutex> lock(mutex);
+    taskDone.wait(lock, [this]() { return pending == 0; });
+}
+
+void Zarr::encodeChunk(const Field& field, int cj, int ci,
+                       vector<float>& chunk, vector<unsigned char>& encoded)
+{
+    // chunks have always the full shape, filled with NaN on edges
+    chunk.assign(size_t(chunkI) * chunkJ, NAN);
+
+    const int i0 = ci * chunkI, j0 = cj * chunkJ;
+    const int ni = min(chunkI, field.ni - i0), nj = min(chunkJ, field.nj - j0);
+
+    for (int j = 0; j < nj; j++) {
+        copy_n(field.values.data() + size_t(j0 + j) * field.ni + i0, ni,
+               chunk.data() + size_t(j) * chunkI);
+    }
+
+    if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+        for (float& v : chunk) {
+            uint32_t u;
+            memcpy(&u, &v, sizeof(u));
+            u = __builtin_bswap32(u);
+            memcpy(&v, &u, sizeof(u));
+        }
+    }
+
+    const string filename = field.path + "/" + to_string(cj) + "." + to_string(ci);
+    const size_t len = chunk.size() * sizeof(float);
+
+#ifdef GRIB2DEC_ZLIB
+    if (compressionLevel >= 0) {
+        uLongf encodedLen = compressBound(len);
+        encoded.resize(encodedLen);
+
+        int ret = compress2(encoded.data(), &encodedLen,
+                            reinterpret_cast<const Bytef*>(chunk.data()), len,
+                            compressionLevel);
+        if (ret != Z_OK) {
+            cerr << "zarr: cannot compress " << filename << endl;
+            return;
+        }
+
+        writeFile(filename, encoded.data(), encodedLen);
+        return;
+    }
+#endif
+
+    writeFile(filename, chunk.data(), len);
+}
+
+void Zarr::submit(function<void()> task)
+{
+    unique_lock<std::mutex> lock(mutex);
+
+    // wait for workers when too many tasks are waiting
+    taskDone.wait(lock, [this]() {
+        return pending < maxPendingByWorker * int(workers.size());
+    });
+
+    tasks.push_back(move(task));
+    pending++;
+    lock.unlock();
+
+    taskAdded.notify_one();
+}
+
+void Zarr::work()
+{
+    while (true) {
+        function<void()> task;
+
+        {
+            unique_lock<std::mutex> lock(mutex);
+            taskAdded.wait(lock, [this]() { return stopped || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+
+        {
+            lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+
+        taskDone.notify_all();
+    }
+}
+
+}
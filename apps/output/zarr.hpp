@@ -0,0 +1,55 @@
+#ifndef __OUTPUT_ZARR_HPP
+#define __OUTPUT_ZARR_HPP
+
+#include "output.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace grib2dec_demo {
+
+/*
+ * Zarr v2 store output : the output is a directory with a group, and
+ * an array by message (field_<n>) of float32 values split in chunks.
+ * Chunks are encoded and written by worker threads while next messages
+ * are decoded.
+ */
+class Zarr : public Output {
+public:
+    Zarr(const std::string& path, const OutputOptions& options);
+    ~Zarr();
+
+    void setComponent(const G2DEC_Message& message);
+    void end();
+
+private:
+    struct Field;
+
+    void encodeChunk(const Field& field, int chunkJ, int chunkI,
+                     std::vector<float>& chunk, std::vector<unsigned char>& encoded);
+
+    // workers
+    void submit(std::function<void()> task);
+    void work();
+
+    const std::string path;
+    const int chunkI, chunkJ;
+    const int compressionLevel;  // < 0 for no compression
+    int nbFields = 0;
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAdded, taskDone;
+    int pending = 0;
+    bool stopped = false;
+};
+
+} // gribdec-demo
+
+#endif
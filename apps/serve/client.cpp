@@ -0,0 +1,129 @@
+#include "client.hpp"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace grib2dec_serve {
+namespace {
+
+template <typename T>
+void append(string& out, const T& value)
+{
+    out.append((const char*)&value, sizeof(value));
+}
+
+bool readAll(int fd, char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t n = recv(fd, data, size, 0);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+} // local namespace
+
+Client::~Client()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+bool Client::connect(const string& socketPath)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+        return false;
+    strcpy(address.sun_path, socketPath.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    return fd >= 0 && ::connect(fd, (sockaddr*)&address, sizeof(address)) == 0;
+}
+
+void Client::addItem(RequestType type, const string& path, int field)
+{
+    const RequestItem item = {type, uint32_t(path.size()), field};
+    append(request, item);
+    request += path;
+    nbRequests++;
+}
+
+void Client::addFields(const string& path)
+{
+    addItem(REQUEST_FIELDS, path, -1);
+}
+
+void Client::addRegion(const string& path, int field,
+                       const G2DEC_SpatialFilter& filter)
+{
+    addItem(REQUEST_REGION, path, field);
+    append(request, filter);
+}
+
+void Client::addPoints(const string& path, int field,
+                       const G2DEC_Point *points, int nbPoints,
+                       G2DEC_Interpolation interpolation)
+{
+    addItem(REQUEST_POINTS, path, field);
+    const PointsRequest pointsRequest = {interpolation, uint32_t(nbPoints)};
+    append(request, pointsRequest);
+    request.append((const char*)points, nbPoints * sizeof(G2DEC_Point));
+}
+
+bool Client::send()
+{
+    const FrameHeader header = {frameMagic, uint32_t(request.size()), nbRequests};
+    const bool sent = writeAll(fd, (const char*)&header, sizeof(header)) &&
+                      writeAll(fd, request.data(), request.size());
+    request.clear();
+    nbRequests = 0;
+    items.clear();
+
+    FrameHeader responseHeader;
+    if (!sent || !readAll(fd, (char*)&responseHeader, sizeof(responseHeader)) ||
+        responseHeader.magic != frameMagic || responseHeader.nbItems != header.nbItems)
+        return false;
+
+    response.resize(responseHeader.size);
+    if (!readAll(fd, &response[0], response.size()))
+        return false;
+
+    size_t offset = 0;
+    for (uint32_t k = 0; k < responseHeader.nbItems; k++) {
+        ResponseItem item;
+        if (response.size() - offset < sizeof(item))
+            return false;
+        memcpy(&item, response.data() + offset, sizeof(item));
+        offset += sizeof(item);
+
+        if (response.size() - offset < item.size)
+            return false;
+        items.push_back({item.status, item.size, offset});
+        offset += item.size;
+    }
+
+    return true;
+}
+
+} // grib2dec_serve
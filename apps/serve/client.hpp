@@ -0,0 +1,66 @@
+#ifndef __SERVE_CLIENT_HPP
+#define __SERVE_CLIENT_HPP
+
+#include "protocol.hpp"
+
+#include <string>
+#include <vector>
+
+namespace grib2dec_serve {
+
+/*
+ * Client of grib2dec-serve: requests are added to a batch, sent together
+ * by send(), then responses are read by item.
+ */
+class Client {
+public:
+    ~Client();
+
+    bool connect(const std::string& socketPath);
+
+    void addFields(const std::string& path);
+    void addRegion(const std::string& path, int field,
+                   const G2DEC_SpatialFilter& filter);
+    void addPoints(const std::string& path, int field,
+                   const G2DEC_Point *points, int nbPoints,
+                   G2DEC_Interpolation interpolation);
+
+    // sends batch and reads responses, false on connection error
+    bool send();
+
+    int size() const {
+        return items.size();
+    }
+
+    G2DEC_Status status(int item) const {
+        return items[item].status;
+    }
+
+    // response data of an item, see protocol.hpp
+    const char *data(int item) const {
+        return response.data() + items[item].offset;
+    }
+
+    uint32_t dataSize(int item) const {
+        return items[item].size;
+    }
+
+private:
+    struct Item {
+        G2DEC_Status status;
+        uint32_t size;
+        size_t offset;
+    };
+
+    void addItem(RequestType type, const std::string& path, int field);
+
+    int fd = -1;
+    uint32_t nbRequests = 0;
+    std::string request;
+    std::string response;
+    std::vector<Item> items;
+};
+
+} // grib2dec_serve
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __SERVE_PROTOCOL_HPP
+#define __SERVE_PROTOCOL_HPP
+
+#include <grib2dec/types.h>
+
+#include <stdint.h>
+
+namespace grib2dec_serve {
+
+/*
+ * Binary protocol of grib2dec-serve, on a local socket: integers and
+ * structures are in native byte order and layout.
+ *
+ * A request is a frame of a batch of items, answered by a frame of as
+ * many items, in the same order. A frame is a FrameHeader followed by
+ * size bytes of items.
+ *
+ * Request item: RequestItem, path of grib2 file (pathLength bytes), then
+ * by type:
+ *  - REQUEST_FIELDS: nothing
+ *  - REQUEST_REGION: G2DEC_SpatialFilter
+ *  - REQUEST_POINTS: PointsRequest, G2DEC_Point [nbPoints]
+ *
+ * Response item: ResponseItem, then size bytes, if status is OK:
+ *  - REQUEST_FIELDS: FieldInfo for each field of file
+ *  - REQUEST_REGION: G2DEC_Grid of region, float values [ni * nj]
+ *  - REQUEST_POINTS: float values [nbPoints], NaN outside grid
+ */
+
+const uint32_t frameMagic = 0x47324453;  // "G2DS"
+
+// bytes of a request frame, larger frames close connection
+const uint32_t maxFrameSize = 256 << 20;
+
+// bytes of a response frame, items above it are answered with an error
+// status and no data
+const uint32_t maxResponseSize = 1 << 30;
+
+struct FrameHeader {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t nbItems;
+};
+
+enum RequestType : uint32_t {
+    REQUEST_FIELDS = 1,
+    REQUEST_REGION = 2,
+    REQUEST_POINTS = 3,
+};
+
+struct RequestItem {
+    uint32_t type;
+    uint32_t pathLength;
+    // field of file, in order of messages and fields; ignored by
+    // REQUEST_FIELDS
+    int32_t field;
+};
+
+struct PointsRequest {
+    G2DEC_Interpolation interpolation;
+    uint32_t nbPoints;
+};
+
+struct ResponseItem {
+    G2DEC_Status status;
+    uint32_t size;
+};
+
+struct FieldInfo {
+    int32_t field;
+    G2DEC_Discipline discipline;
+    G2DEC_Category category;
+    G2DEC_Parameter parameter;
+    G2DEC_Datetime datetime;
+    G2DEC_Product product;
+    G2DEC_Grid grid;
+};
+
+} // grib2dec_serve
+
+#endif
@@ -0,0 +1,264 @@
+#include "client.hpp"
+#include "server.hpp"
+#include "store.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace grib2dec_serve;
+
+namespace {
+
+struct Query {
+    RequestType type;
+    string path;
+    int field = -1;
+    G2DEC_SpatialFilter filter;
+    vector<G2DEC_Point> points;
+};
+
+struct Parameters {
+    string socketPath;
+    bool client = false;
+    size_t memory = size_t(1024) << 20;
+    vector<string> preload;
+    vector<Query> queries;
+    G2DEC_Interpolation interpolation = G2DEC_INTERPOLATION_NEAREST;
+};
+
+// socket removed on termination
+char socketFile[108];
+
+int usage()
+{
+    cerr << "grib2dec-serve : decode grib2 files once, serve fields on a unix socket" << endl;
+    cerr << "server:" << endl;
+    cerr << " grib2dec-serve --socket path [--memory MB] [file.grb2 ...]" << endl;
+    cerr << "  --memory MB : memory of decoded values, least recently used files" << endl;
+    cerr << "                are dropped above it (default: 1024)" << endl;
+    cerr << "  files are decoded at start" << endl;
+    cerr << "client, queries sent in a single batch:" << endl;
+    cerr << " grib2dec-serve --connect path queries..." << endl;
+    cerr << "  --fields file : fields of file" << endl;
+    cerr << "  --region file field latMin,latMax,lonMin,lonMax : values of a field region" << endl;
+    cerr << "  --points file field pointsFile : values of a field at points, read as" << endl;
+    cerr << "                                   'lat lon' lines" << endl;
+    cerr << "  --interpolation nearest|bilinear : interpolation of points (default: nearest)" << endl;
+    return -1;
+}
+
+int error(const char *msg, const char *msg2 = nullptr)
+{
+    cerr << "error: " << msg;
+    if (msg2)
+        cerr << msg2;
+    cerr << endl;
+    return -1;
+}
+
+bool parsePoints(const char *filename, vector<G2DEC_Point>& points)
+{
+    ifstream fin(filename);
+    if (!fin.is_open())
+        return false;
+
+    G2DEC_Point point;
+    while (fin >> point.lat >> point.lon)
+        points.push_back(point);
+
+    return true;
+}
+
+bool parseArguments(int argc, char *argv[], Parameters& params)
+{
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.size() < 2 || arg[0] != '-') {
+            params.preload.push_back(arg);
+            continue;
+        }
+
+        // number of values of option
+        const int nbValues = arg == "--region" || arg == "--points" ? 3 : 1;
+        if (i + nbValues >= argc)
+            return error("missing value of ", argv[i]), false;
+
+        if (arg == "--socket")
+            params.socketPath = argv[++i];
+        else if (arg == "--connect") {
+            params.socketPath = argv[++i];
+            params.client = true;
+        } else if (arg == "--memory") {
+            const long megabytes = atol(argv[++i]);
+            if (megabytes <= 0)
+                return error("bad memory ", argv[i]), false;
+            params.memory = size_t(megabytes) << 20;
+        } else if (arg == "--fields") {
+            Query query;
+            query.type = REQUEST_FIELDS;
+            query.path = argv[++i];
+            params.queries.push_back(query);
+        } else if (arg == "--region") {
+            Query query;
+            query.type = REQUEST_REGION;
+            query.path = argv[++i];
+            query.field = atoi(argv[++i]);
+            G2DEC_SpatialFilter& f = query.filter;
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &f.latMin, &f.latMax,
+                       &f.lonMin, &f.lonMax) != 4)
+                return error("bad region ", argv[i]), false;
+            params.queries.push_back(query);
+        } else if (arg == "--points") {
+            Query query;
+            query.type = REQUEST_POINTS;
+            query.path = argv[++i];
+            query.field = atoi(argv[++i]);
+            if (!parsePoints(argv[++i], query.points))
+                return error("cannot read points in ", argv[i]), false;
+            params.queries.push_back(query);
+        } else if (arg == "--interpolation") {
+            string interpolation = argv[++i];
+            if (interpolation == "nearest")
+                params.interpolation = G2DEC_INTERPOLATION_NEAREST;
+            else if (interpolation == "bilinear")
+                params.interpolation = G2DEC_INTERPOLATION_BILINEAR;
+            else
+                return error("unknown interpolation ", argv[i]), false;
+        } else
+            return error("unknown option ", argv[i]), false;
+    }
+
+    if (params.client)
+        return !params.queries.empty() && params.preload.empty();
+
+    return !params.socketPath.empty() && params.queries.empty();
+}
+
+void stopServer(int)
+{
+    unlink(socketFile);
+    _exit(0);
+}
+
+int runServer(const Parameters& params)
+{
+    FieldStore store(params.memory);
+
+    for (const string& path : params.preload) {
+        if (!store.get(path))
+            return error("cannot decode ", path.c_str());
+    }
+
+    Server server(store);
+    if (!server.listen(params.socketPath))
+        return -1;
+
+    // removed on termination only once created by server
+    strncpy(socketFile, params.socketPath.c_str(), sizeof(socketFile) - 1);
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+
+    cerr << "serve: listening on " << params.socketPath << ", "
+         << store.memoryUsed() / 1e6 << " MB decoded" << endl;
+
+    return server.run() ? 0 : -1;
+}
+
+template <typename T>
+T read(const char *data)
+{
+    T value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void printFields(const Query& query, const char *data, uint32_t size)
+{
+    for (uint32_t offset = 0; offset + sizeof(FieldInfo) <= size; offset += sizeof(FieldInfo)) {
+        const FieldInfo info = read<FieldInfo>(data + offset);
+        const G2DEC_Datetime& d = info.datetime;
+        printf("%s field %d discipline %d category %d parameter %d level %d:%g "
+               "forecast %d unit %d %04d-%02d-%02dT%02d:%02d:%02d grid %dx%d\n",
+               query.path.c_str(), info.field, info.discipline, info.category,
+               info.parameter, info.product.levelType, info.product.level,
+               info.product.forecastTime, info.product.timeUnit, d.year,
+               d.month, d.day, d.hour, d.minute, d.second, info.grid.ni,
+               info.grid.nj);
+    }
+}
+
+void printRegion(const Query& query, const char *data, uint32_t size)
+{
+    const G2DEC_Grid grid = read<G2DEC_Grid>(data);
+    printf("%s field %d region %dx%d lat %g..%g lon %g..%g\n", query.path.c_str(),
+           query.field, grid.ni, grid.nj, grid.lat1, grid.lat2, grid.lon1, grid.lon2);
+
+    const int nbValues = (size - sizeof(grid)) / sizeof(float);
+    for (int k = 0; k < nbValues; k++) {
+        printf("%g%c", read<float>(data + sizeof(grid) + k * sizeof(float)),
+               (k + 1) % grid.ni ? ' ' : '\n');
+    }
+}
+
+void printPoints(const Query& query, const char *data)
+{
+    for (size_t p = 0; p < query.points.size(); p++) {
+        printf("%g %g %g\n", query.points[p].lat, query.points[p].lon,
+               read<float>(data + p * sizeof(float)));
+    }
+}
+
+int runClient(const Parameters& params)
+{
+    Client client;
+    if (!client.connect(params.socketPath))
+        return error("cannot connect to ", params.socketPath.c_str());
+
+    for (const Query& query : params.queries) {
+        if (query.type == REQUEST_FIELDS)
+            client.addFields(query.path);
+        else if (query.type == REQUEST_REGION)
+            client.addRegion(query.path, query.field, query.filter);
+        else
+            client.addPoints(query.path, query.field, query.points.data(),
+                             query.points.size(), params.interpolation);
+    }
+
+    if (!client.send())
+        return error("connection lost");
+
+    int result = 0;
+    for (int k = 0; k < client.size(); k++) {
+        const Query& query = params.queries[k];
+        if (client.status(k) != G2DEC_STATUS_OK) {
+            cerr << "error: status " << client.status(k) << " for " << query.path << endl;
+            result = -1;
+        } else if (query.type == REQUEST_FIELDS)
+            printFields(query, client.data(k), client.dataSize(k));
+        else if (query.type == REQUEST_REGION)
+            printRegion(query, client.data(k), client.dataSize(k));
+        else
+            printPoints(query, client.data(k));
+    }
+
+    return result;
+}
+
+} // local namespace
+
+int main(int argc, char *argv[])
+{
+    Parameters params;
+    if (!parseArguments(argc, argv, params))
+        return usage();
+
+    return params.client ? runClient(params) : runServer(params);
+}
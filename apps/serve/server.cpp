@@ -0,0 +1,324 @@
+#include "server.hpp"
+
+// library internals, for points interpolation and gaussian rows
+#include "gaussian.hpp"
+#include "points.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace grib2dec_serve {
+namespace {
+
+const double epsilon = 1e-6;
+
+bool readAll(int fd, char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t n = recv(fd, data, size, 0);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+template <typename T>
+void append(string& out, const T& value)
+{
+    out.append((const char*)&value, sizeof(value));
+}
+
+// reads a structure of request, false if request is too short
+template <typename T>
+bool take(const char *&p, const char *end, T& value)
+{
+    if (end - p < (ptrdiff_t)sizeof(value))
+        return false;
+    memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return true;
+}
+
+// distance of a longitude after lonMin, in [0, 360[
+double lonAfter(double lon, double lonMin)
+{
+    double d = fmod(lon - lonMin, 360.);
+    return d < 0 ? d + 360. : d;
+}
+
+/*
+ * Rows and columns of a field in a spatial filter, limits of a pair at 0
+ * meaning no filter. Columns are in longitude order from lonMin, across
+ * first column of global grids.
+ */
+G2DEC_Status extractRegion(const FieldInfo& info, const vector<float>& values,
+                           const G2DEC_SpatialFilter& filter, G2DEC_Grid& grid,
+                           vector<float>& regionValues)
+{
+    const G2DEC_Grid& source = info.grid;
+    if (source.projection.type != G2DEC_PROJECTION_NONE)
+        return G2DEC_STATUS_NOT_IMPLEMENTED;
+
+    vector<double> latitudes;
+    if (!grib2dec::gaussianRows(source, latitudes)) {
+        latitudes.clear();
+        for (int j = 0; j < source.nj; j++)
+            latitudes.push_back(source.lat1 + j * source.latInc);
+    }
+
+    const bool allLats = filter.latMin == 0 && filter.latMax == 0;
+    const bool allLons = filter.lonMin == 0 && filter.lonMax == 0;
+
+    vector<int> rows;
+    for (int j = 0; j < source.nj; j++) {
+        if (allLats || (latitudes[j] > filter.latMin - epsilon &&
+                        latitudes[j] < filter.latMax + epsilon))
+            rows.push_back(j);
+    }
+
+    const double width = allLons ? 360. : lonAfter(filter.lonMax, filter.lonMin);
+    vector<pair<double, int>> columns;
+    for (int i = 0; i < source.ni; i++) {
+        const double d = lonAfter(source.lon1 + i * source.lonInc,
+                                  allLons ? source.lon1 : filter.lonMin);
+        if (d < width + epsilon || 360. - d < epsilon)
+            columns.push_back({360. - d < epsilon ? 0. : d, i});
+    }
+    sort(columns.begin(), columns.end());
+
+    grid = source;
+    grid.ni = columns.size();
+    grid.nj = rows.size();
+    regionValues.clear();
+    if (rows.empty() || columns.empty())
+        return G2DEC_STATUS_OK;
+
+    grid.lat1 = latitudes[rows.front()];
+    grid.lat2 = latitudes[rows.back()];
+    grid.lon1 = source.lon1 + columns.front().second * source.lonInc;
+    grid.lon2 = source.lon1 + columns.back().second * source.lonInc;
+
+    regionValues.reserve(size_t(grid.ni) * grid.nj);
+    for (int j : rows) {
+        for (const auto& column : columns)
+            regionValues.push_back(values[size_t(j) * source.ni + column.second]);
+    }
+
+    return G2DEC_STATUS_OK;
+}
+
+void interpolatePoints(const FieldInfo& info, const vector<float>& values,
+                       const G2DEC_Point *points, int nbPoints,
+                       G2DEC_Interpolation interpolation,
+                       vector<float>& pointValues)
+{
+    grib2dec::PointsQuery query;
+    query.set(points, nbPoints, interpolation);
+    const grib2dec::PointWeights& weights = query.weights(info.grid);
+
+    // rows needed by points, in rows buffer
+    const size_t ni = info.grid.ni;
+    vector<double> rows(weights.rows.size() * ni);
+    for (size_t r = 0; r < weights.rows.size(); r++) {
+        const float *row = &values[weights.rows[r] * ni];
+        copy(row, row + ni, rows.begin() + r * ni);
+    }
+
+    vector<double> result;
+    grib2dec::applyPointWeights(weights, rows, result);
+    pointValues.assign(result.begin(), result.end());
+}
+
+} // local namespace
+
+Server::~Server()
+{
+    if (listener >= 0)
+        close(listener);
+}
+
+bool Server::listen(const string& socketPath)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "serve: socket path too long" << endl;
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    // socket of a previous server is replaced, other files are kept
+    struct stat status;
+    if (lstat(socketPath.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            cerr << "serve: " << socketPath << " exists and is not a socket" << endl;
+            return false;
+        }
+        unlink(socketPath.c_str());
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || ::bind(listener, (sockaddr*)&address, sizeof(address)) < 0 ||
+        ::listen(listener, 64) < 0) {
+        cerr << "serve: cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Server::run()
+{
+    while (true) {
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            cerr << "serve: accept: " << strerror(errno) << endl;
+            return false;
+        }
+
+        thread([this, fd]() {
+            serve(fd);
+            close(fd);
+        }).detach();
+    }
+}
+
+void Server::serve(int fd)
+{
+    string request, response;
+    FrameHeader header;
+
+    while (readAll(fd, (char*)&header, sizeof(header))) {
+        if (header.magic != frameMagic || header.size > maxFrameSize)
+            return;
+
+        request.resize(header.size);
+        if (!readAll(fd, &request[0], request.size()))
+            return;
+
+        response.clear();
+        if (!handleFrame(request, header.nbItems, response))
+            return;
+
+        const FrameHeader responseHeader = {frameMagic, uint32_t(response.size()),
+                                            header.nbItems};
+        if (!writeAll(fd, (const char*)&responseHeader, sizeof(responseHeader)) ||
+            !writeAll(fd, response.data(), response.size()))
+            return;
+    }
+}
+
+bool Server::handleFrame(const string& request, uint32_t nbItems,
+                         string& response)
+{
+    const char *p = request.data();
+    const char *end = p + request.size();
+    vector<float> values;
+
+    // data of an item fits in response frame
+    auto fits = [&](size_t size) {
+        return size <= maxResponseSize - min<size_t>(response.size(), maxResponseSize);
+    };
+
+    for (uint32_t k = 0; k < nbItems; k++) {
+        RequestItem item;
+        if (!take(p, end, item) || end - p < (ptrdiff_t)item.pathLength)
+            return false;
+
+        const string path(p, item.pathLength);
+        p += item.pathLength;
+
+        G2DEC_SpatialFilter filter;
+        PointsRequest pointsRequest;
+        const char *points = nullptr;
+
+        if (item.type == REQUEST_REGION) {
+            if (!take(p, end, filter))
+                return false;
+        } else if (item.type == REQUEST_POINTS) {
+            if (!take(p, end, pointsRequest) ||
+                size_t(end - p) / sizeof(G2DEC_Point) < pointsRequest.nbPoints)
+                return false;
+            points = p;
+            p += pointsRequest.nbPoints * sizeof(G2DEC_Point);
+        } else if (item.type != REQUEST_FIELDS) {
+            return false;
+        }
+
+        // response item size is set after its data
+        const size_t itemBegin = response.size();
+        ResponseItem responseItem = {G2DEC_STATUS_OK, 0};
+        append(response, responseItem);
+
+        shared_ptr<const FileFields> fields = store.get(path);
+        if (!fields) {
+            responseItem.status = G2DEC_STATUS_ERROR;
+        } else if (item.type == REQUEST_FIELDS) {
+            if (!fits(fields->infos.size() * sizeof(FieldInfo)))
+                responseItem.status = G2DEC_STATUS_ERROR;
+            else {
+                for (const FieldInfo& info : fields->infos)
+                    append(response, info);
+            }
+        } else if (item.field < 0 || item.field >= (int)fields->infos.size()) {
+            responseItem.status = G2DEC_STATUS_ERROR;
+        } else if (item.type == REQUEST_REGION) {
+            G2DEC_Grid grid;
+            responseItem.status = extractRegion(fields->infos[item.field],
+                                                fields->values[item.field],
+                                                filter, grid, values);
+            if (responseItem.status == G2DEC_STATUS_OK &&
+                !fits(sizeof(grid) + values.size() * sizeof(float)))
+                responseItem.status = G2DEC_STATUS_ERROR;
+            if (responseItem.status == G2DEC_STATUS_OK) {
+                append(response, grid);
+                response.append((const char*)values.data(), values.size() * sizeof(float));
+            }
+        } else if (!fits(size_t(pointsRequest.nbPoints) * sizeof(float))) {
+            responseItem.status = G2DEC_STATUS_ERROR;
+        } else {
+            // points may be unaligned in request
+            vector<G2DEC_Point> alignedPoints(pointsRequest.nbPoints);
+            memcpy(alignedPoints.data(), points, alignedPoints.size() * sizeof(G2DEC_Point));
+            interpolatePoints(fields->infos[item.field], fields->values[item.field],
+                              alignedPoints.data(), alignedPoints.size(),
+                              pointsRequest.interpolation, values);
+            response.append((const char*)values.data(), values.size() * sizeof(float));
+        }
+
+        responseItem.size = response.size() - itemBegin - sizeof(responseItem);
+        memcpy(&response[itemBegin], &responseItem, sizeof(responseItem));
+    }
+
+    return true;
+}
+
+} // grib2dec_serve
@@ -0,0 +1,38 @@
+#ifndef __SERVE_SERVER_HPP
+#define __SERVE_SERVER_HPP
+
+#include "store.hpp"
+
+#include <string>
+
+namespace grib2dec_serve {
+
+/*
+ * Server of decoded fields on a unix socket, a thread by connection.
+ * See protocol.hpp.
+ */
+class Server {
+public:
+    explicit Server(FieldStore& store)
+        : store(store) {}
+
+    ~Server();
+
+    // creates socket, false on error or if path is not a socket
+    bool listen(const std::string& socketPath);
+
+    // accepts connections until process ends, false on socket error
+    bool run();
+
+private:
+    void serve(int fd);
+    bool handleFrame(const std::string& request, uint32_t nbItems,
+                     std::string& response);
+
+    FieldStore& store;
+    int listener = -1;
+};
+
+} // grib2dec_serve
+
+#endif
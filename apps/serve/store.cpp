@@ -0,0 +1,118 @@
+#include "store.hpp"
+
+#include <grib2dec/grib2dec.hpp>
+
+#include <iostream>
+#include <limits.h>
+#include <stdlib.h>
+
+using namespace std;
+
+namespace grib2dec_serve {
+namespace {
+
+shared_ptr<const FileFields> decodeFile(const string& path)
+{
+    unique_ptr<grib2dec::Grib2Dec> decoder(grib2dec::Grib2Dec::create(path.c_str()));
+    if (!decoder)
+        return nullptr;
+
+    auto fields = make_shared<FileFields>();
+    G2DEC_Message message;
+    G2DEC_Status status;
+
+    while ((status = decoder->nextMessage(message)) != G2DEC_STATUS_END) {
+        if (status != G2DEC_STATUS_OK || !message.values)
+            continue;
+
+        FieldInfo info;
+        info.field = fields->infos.size();
+        info.discipline = message.discipline;
+        info.category = message.category;
+        info.parameter = message.parameter;
+        info.datetime = message.datetime;
+        info.product = message.product;
+        info.grid = message.grid;
+
+        fields->infos.push_back(info);
+        fields->values.emplace_back(message.values, message.values + message.valuesLength);
+        fields->bytes += message.valuesLength * sizeof(float) + sizeof(info);
+    }
+
+    return fields;
+}
+
+} // local namespace
+
+shared_ptr<const FileFields> FieldStore::get(const string& filename)
+{
+    // same entry for relative paths and links of a file
+    char resolved[PATH_MAX];
+    if (!realpath(filename.c_str(), resolved))
+        return nullptr;
+    const string path = resolved;
+
+    shared_ptr<Entry> entry;
+    {
+        lock_guard<mutex> lock(storeMutex);
+        shared_ptr<Entry>& e = entries[path];
+        if (!e)
+            e = make_shared<Entry>();
+        entry = e;
+
+        if (entry->fields) {
+            lru.splice(lru.begin(), lru, entry->lru);
+            return entry->fields;
+        }
+    }
+
+    // decoded by first connection asking for it, others wait
+    lock_guard<mutex> loading(entry->loading);
+    {
+        lock_guard<mutex> lock(storeMutex);
+        if (entry->fields)
+            return entry->fields;
+    }
+
+    shared_ptr<const FileFields> fields = decodeFile(path);
+
+    lock_guard<mutex> lock(storeMutex);
+    if (!fields) {
+        entries.erase(path);
+        return nullptr;
+    }
+
+    // entry was erased if a previous decoding failed
+    shared_ptr<Entry>& e = entries[path];
+    if (!e)
+        e = entry;
+    else if (e->fields)
+        return e->fields;
+
+    e->fields = fields;
+    lru.push_front(path);
+    e->lru = lru.begin();
+    used += fields->bytes;
+    evict(path);
+
+    return fields;
+}
+
+size_t FieldStore::memoryUsed() const
+{
+    lock_guard<mutex> lock(storeMutex);
+    return used;
+}
+
+void FieldStore::evict(const string& kept)
+{
+    while (used > budget && !lru.empty() && lru.back() != kept) {
+        auto it = entries.find(lru.back());
+        used -= it->second->fields->bytes;
+        cerr << "serve: dropping " << lru.back() << endl;
+        entries.erase(it);
+        lru.pop_back();
+    }
+}
+
+} // grib2dec_serve
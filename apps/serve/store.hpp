@@ -0,0 +1,56 @@
+#ifndef __SERVE_STORE_HPP
+#define __SERVE_STORE_HPP
+
+#include "protocol.hpp"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace grib2dec_serve {
+
+// decoded fields of a grib2 file
+struct FileFields {
+    std::vector<FieldInfo> infos;
+    std::vector<std::vector<float>> values;  // by field, in raster order
+    size_t bytes = 0;
+};
+
+/*
+ * Decoded files by real path. A file is decoded once, even when requested by
+ * several connections at the same time, and kept while values of files
+ * fit in memory budget: least recently used files are dropped first.
+ */
+class FieldStore {
+public:
+    explicit FieldStore(size_t budget)
+        : budget(budget) {}
+
+    // fields of a file, nullptr if file cannot be open
+    std::shared_ptr<const FileFields> get(const std::string& filename);
+
+    size_t memoryUsed() const;
+
+private:
+    struct Entry {
+        std::mutex loading;
+        std::shared_ptr<const FileFields> fields;
+        std::list<std::string>::iterator lru;
+    };
+
+    void evict(const std::string& kept);
+
+    const size_t budget;
+
+    mutable std::mutex storeMutex;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+    std::list<std::string> lru;  // paths of decoded files, last used first
+    size_t used = 0;
+};
+
+} // grib2dec_serve
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "types.h"
 
+#include <stdio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -27,6 +29,60 @@ G2DEC_Handle G2DEC_open(const char *filename);
 G2DEC_Status G2DEC_setSpatialFilter(G2DEC_Handle handle,
                                     const G2DEC_SpatialFilter *filter);
 
+/**
+ * Set decimation of data points, applied after spatial filter.
+ *
+ * ni, nj, lon2, lat2, lonInc and latInc in message.grid are set
+ * accordingly to decimation.
+ */
+G2DEC_Status G2DEC_setDecimation(G2DEC_Handle handle,
+                                 const G2DEC_Decimation *decimation);
+
+/**
+ * Set several regions to extract in a single decoding pass.
+ *
+ * When regions are set, message values are not filled and spatial
+ * filter is ignored : each region gets its own values and grid in
+ * message.regions. Set 0 region to disable.
+ */
+G2DEC_Status G2DEC_setRegions(G2DEC_Handle handle,
+                              const G2DEC_SpatialFilter *regions,
+                              int nbRegions);
+
+/**
+ * Set points where values are extracted.
+ *
+ * When points are set, message values and regions are not filled,
+ * message.pointValues gets interpolated values in points order.
+ * Set 0 point to disable.
+ */
+G2DEC_Status G2DEC_setPoints(G2DEC_Handle handle,
+                             const G2DEC_Point *points,
+                             int nbPoints,
+                             G2DEC_Interpolation interpolation);
+
+/**
+ * Set a target grid where values are remapped.
+ *
+ * When a target grid is set, message.grid is the target grid and
+ * message values are interpolated on it. Remap weights are computed
+ * once by source grid definition.
+ * A grid with ni or nj of 0 disables regridding.
+ */
+G2DEC_Status G2DEC_setRegrid(G2DEC_Handle handle,
+                             const G2DEC_Grid *target,
+                             G2DEC_Interpolation interpolation);
+
+/**
+ * Set selections of messages by product.
+ *
+ * Only messages matching one of the selections are returned, others are
+ * skipped without reading their data. Set 0 selection to disable.
+ */
+G2DEC_Status G2DEC_setSelections(G2DEC_Handle handle,
+                                 const G2DEC_Selection *selections,
+                                 int nbSelections);
+
 /**
  * Read next message.
  *
@@ -35,6 +91,160 @@ G2DEC_Status G2DEC_setSpatialFilter(G2DEC_Handle handle,
  */
 G2DEC_Status G2DEC_nextMessage(G2DEC_Handle handle, G2DEC_Message *message);
 
+/**
+ * Get latitudes of last message values, or of a region values.
+ *
+ * Latitudes of rows (nj values) for latitude / longitude and gaussian
+ * grids, latitude of each value (ni * nj values) for projected grids.
+ * Spatial filter and decimation are taken into account, region is -1 for
+ * message values. Arrays are computed once by grid definition and filter,
+ * and valid until coordinates of 8 other grid definitions or filters are
+ * got.
+ */
+G2DEC_Status G2DEC_getLatitudes(G2DEC_Handle handle, int region,
+                                const double **latitudes, int *length);
+
+/**
+ * Get longitudes of last message values, or of a region values.
+ *
+ * Longitudes of columns (ni values) for latitude / longitude and gaussian
+ * grids, longitude of each value for projected grids.
+ * See G2DEC_getLatitudes().
+ */
+G2DEC_Status G2DEC_getLongitudes(G2DEC_Handle handle, int region,
+                                 const double **longitudes, int *length);
+
+/**
+ * Set recovery mode if enabled is not 0, disabled by default.
+ *
+ * In recovery mode, a message is read only if its end section is where its
+ * length says. Otherwise, and after garbage or a truncated message, input
+ * is scanned for the next valid message instead of ending.
+ */
+void G2DEC_setRecovery(G2DEC_Handle handle, int enabled);
+
+/**
+ * Set log level of decoding errors, G2DEC_LOG_WARNING by default.
+ */
+void G2DEC_setLogLevel(G2DEC_Handle handle, G2DEC_LogLevel level);
+
+/**
+ * Set a callback for decoding errors up to log level, instead of writing
+ * them to stderr. NULL restores stderr.
+ */
+void G2DEC_setLogCallback(G2DEC_Handle handle, G2DEC_LogCallback callback,
+                          void *userData);
+
+/**
+ * Text of last decoding error, or empty string.
+ */
+const char *G2DEC_getLastError(G2DEC_Handle handle);
+
+/**
+ * Get decoding statistics: counters and timers by section and phase.
+ *
+ * Statistics are available only if library is built with GRIB2DEC_STATS
+ * option, G2DEC_STATUS_NOT_IMPLEMENTED is returned otherwise.
+ */
+G2DEC_Status G2DEC_getStats(G2DEC_Handle handle, G2DEC_Stats *stats);
+
+/**
+ * Reset decoding statistics.
+ */
+void G2DEC_resetStats(G2DEC_Handle handle);
+
+/**
+ * Start recording a timeline of decoding, in all threads and handles.
+ * Previous events are cleared. Call it when no decoding is running.
+ */
+void G2DEC_startTrace();
+
+/**
+ * Stop recording the timeline, and write it to filename in Chrome trace
+ * JSON format (chrome://tracing or Perfetto).
+ */
+G2DEC_Status G2DEC_stopTrace(const char *filename);
+
+/**
+ * Encode a message in grib2 format, with complex packing, and write it
+ * to file.
+ *
+ * identification and product definition sections are copied from
+ * message raw sections : a decoded message can be written back.
+ */
+G2DEC_Status G2DEC_encode(const G2DEC_Message *message,
+                          const G2DEC_EncodeOptions *options,
+                          FILE *file);
+
+/**
+ * Build a point-major time series cube from forecast files, a time by
+ * file, see buildCube() in C++ interface. If status is not OK and error
+ * is not NULL, error text is copied in error (errorSize bytes at most).
+ */
+G2DEC_Status G2DEC_buildCube(const char *const *inputs, int nbInputs,
+                             const G2DEC_Selection *parameters,
+                             int nbParameters,
+                             const G2DEC_CubeOptions *options,
+                             const char *output, char *error, int errorSize);
+
+/**
+ * Read header of a cube file.
+ */
+G2DEC_Status G2DEC_readCubeHeader(const char *filename,
+                                  G2DEC_CubeHeader *header);
+
+/**
+ * Read time series of a point in a cube file: nbParameters * nbTimes
+ * values, by parameter.
+ */
+G2DEC_Status G2DEC_readCubePoint(const char *filename, int point,
+                                 float *values);
+
+typedef void* G2DEC_WindHandle;
+
+/**
+ * Create a wind query engine, see grib2dec::WindQuery
+ */
+G2DEC_WindHandle G2DEC_createWindQuery();
+
+/**
+ * Set level of wind fields, 10 m above ground by default
+ */
+void G2DEC_windSetLevel(G2DEC_WindHandle handle, int levelType, double level);
+
+/**
+ * Set time range of queries: fields not bracketing it are dropped
+ */
+void G2DEC_windSetTimeRange(G2DEC_WindHandle handle, double begin, double end);
+
+/**
+ * Load wind fields of a file
+ */
+G2DEC_Status G2DEC_windLoad(G2DEC_WindHandle handle, const char *filename);
+
+/**
+ * Text of error of last load, or empty string
+ */
+const char *G2DEC_windGetLastError(G2DEC_WindHandle handle);
+
+/**
+ * Get valid times of fields available for queries
+ */
+G2DEC_Status G2DEC_windGetTimes(G2DEC_WindHandle handle, const double **times,
+                                int *length);
+
+/**
+ * Interpolate wind components at points in space and time
+ */
+G2DEC_Status G2DEC_windQuery(G2DEC_WindHandle handle,
+                             const G2DEC_WindPoint *points, int nbPoints,
+                             double *u, double *v);
+
+/**
+ * Delete a wind query engine
+ */
+void G2DEC_deleteWindQuery(G2DEC_WindHandle handle);
+
 /**
  * Close library
  */
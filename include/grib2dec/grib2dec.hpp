@@ -4,6 +4,8 @@
 #include "types.h"
 
 #include <istream>
+#include <ostream>
+#include <string>
 
 namespace grib2dec {
 
@@ -14,6 +16,9 @@ public:
      *
      * message structure will be fullfilled only if returned status is OK.
      * call this method until END status is returned.
+     *
+     * A grib2 message with several fields (repeated sections 3 to 7) is
+     * returned field by field, see message.field.
      */
     virtual G2DEC_Status nextMessage(G2DEC_Message& message) = 0;
 
@@ -25,6 +30,128 @@ public:
      */
     virtual G2DEC_Status setSpatialFilter(const G2DEC_SpatialFilter& filter) = 0;
 
+    /**
+     * Set decimation of data points, applied after spatial filter.
+     *
+     * ni, nj, lon2, lat2, lonInc and latInc in message.grid are set
+     * accordingly to decimation.
+     */
+    virtual G2DEC_Status setDecimation(const G2DEC_Decimation& decimation) = 0;
+
+    /**
+     * Set several regions to extract in a single decoding pass.
+     *
+     * When regions are set, message values are not filled and spatial
+     * filter is ignored : each region gets its own values and grid in
+     * message.regions. Rows covered by no region are skipped.
+     * Set 0 region to disable.
+     */
+    virtual G2DEC_Status setRegions(const G2DEC_SpatialFilter *regions,
+                                    int nbRegions) = 0;
+
+    /**
+     * Set points where values are extracted.
+     *
+     * When points are set, message values and regions are not filled,
+     * message.pointValues gets interpolated values in points order.
+     * Only grid rows needed by points are decoded, and interpolation
+     * weights are computed once by grid definition.
+     * Set 0 point to disable.
+     */
+    virtual G2DEC_Status setPoints(const G2DEC_Point *points, int nbPoints,
+                                   G2DEC_Interpolation interpolation) = 0;
+
+    /**
+     * Set a target grid where values are remapped.
+     *
+     * When a target grid is set, message.grid is the target grid and
+     * message values are interpolated on it. Remap weights are computed
+     * once by source grid definition. Points replace target grid, and
+     * target grid replaces regions and spatial filter.
+     * A grid with ni or nj of 0 disables regridding.
+     *
+     * target grid is defined by ni, nj, lat1, lon1, latInc and lonInc.
+     */
+    virtual G2DEC_Status setRegrid(const G2DEC_Grid& target,
+                                   G2DEC_Interpolation interpolation) = 0;
+
+    /**
+     * Set selections of messages by product: level, forecast time,
+     * ensemble member, statistical process or parameter.
+     *
+     * Only messages matching one of the selections are returned by
+     * nextMessage(), others are skipped after their product definition
+     * section, without reading their data.
+     * Set 0 selection to disable.
+     */
+    virtual G2DEC_Status setSelections(const G2DEC_Selection *selections,
+                                       int nbSelections) = 0;
+
+    /**
+     * Get latitudes of last message values, or of a region values.
+     *
+     * For latitude / longitude and gaussian grids, latitudes of rows (nj
+     * values). For projected grids, latitude of each value (ni * nj
+     * values, in values order). Spatial filter and decimation are taken
+     * into account, region is -1 for message values.
+     *
+     * Arrays are computed once by grid definition and filter, and shared
+     * by all messages on this grid. The last 8 are kept: arrays are valid
+     * until coordinates of 8 other grid definitions or filters are got.
+     * ERROR is returned if last message has no grid values (points).
+     */
+    virtual G2DEC_Status getLatitudes(const double *&latitudes, int& length,
+                                      int region = -1) = 0;
+
+    /**
+     * Get longitudes of last message values, or of a region values.
+     *
+     * Longitudes of columns (ni values) for latitude / longitude and
+     * gaussian grids, longitude of each value for projected grids.
+     * See getLatitudes().
+     */
+    virtual G2DEC_Status getLongitudes(const double *&longitudes, int& length,
+                                       int region = -1) = 0;
+
+    /**
+     * Set recovery mode, disabled by default.
+     *
+     * In recovery mode, a message is read only if its end section is where
+     * its length says. Otherwise, and after garbage or a truncated message,
+     * input is scanned for the next valid message instead of ending.
+     */
+    virtual void setRecovery(bool enabled) = 0;
+
+    /**
+     * Set log level of decoding errors, G2DEC_LOG_WARNING by default.
+     */
+    virtual void setLogLevel(G2DEC_LogLevel level) = 0;
+
+    /**
+     * Set a callback for decoding errors up to log level, instead of
+     * writing them to std::cerr. nullptr restores std::cerr.
+     */
+    virtual void setLogCallback(G2DEC_LogCallback callback,
+                                void *userData) = 0;
+
+    /**
+     * Text of last decoding error, whatever the log level, or empty string.
+     */
+    virtual const char *getLastError() const = 0;
+
+    /**
+     * Get decoding statistics: counters and timers by section and phase.
+     *
+     * Statistics are available only if library is built with
+     * GRIB2DEC_STATS option, NOT_IMPLEMENTED is returned otherwise.
+     */
+    virtual G2DEC_Status getStats(G2DEC_Stats& stats) const = 0;
+
+    /**
+     * Reset decoding statistics.
+     */
+    virtual void resetStats() = 0;
+
     /**
      * Create a grib2 decoder with a filename.
      *
@@ -41,6 +168,124 @@ public:
     virtual ~Grib2Dec() {}
 };
 
+/**
+ * Encode a message in grib2 format, with complex packing.
+ *
+ * grid, discipline and values are taken from message, identification and
+ * product definition sections are copied from message raw sections : a
+ * decoded message (filtered, decimated or regridded) can be written back.
+ * Grid is written as a regular latitude / longitude grid.
+ */
+G2DEC_Status encode(const G2DEC_Message& message,
+                    const G2DEC_EncodeOptions& options, std::ostream& out);
+
+/**
+ * Build a point-major time series cube from forecast files, a time by file
+ * in inputs order, and write it to output.
+ *
+ * Files are decoded in parallel, keeping for each parameter the first
+ * message matching its selection, restricted to region. Values are then
+ * transposed by blocks of points, so that memory used is bounded by a
+ * block and not by the cube. Messages must have the same grid.
+ * See G2DEC_CubeHeader for the file format.
+ *
+ * If status is not OK, error is set to the error text when given.
+ */
+G2DEC_Status buildCube(const char *const *inputs, int nbInputs,
+                       const G2DEC_Selection *parameters, int nbParameters,
+                       const G2DEC_CubeOptions& options, const char *output,
+                       std::string *error = nullptr);
+
+/**
+ * Read header of a cube file.
+ */
+G2DEC_Status readCubeHeader(const char *filename, G2DEC_CubeHeader& header);
+
+/**
+ * Read time series of a point in a cube file: nbParameters * nbTimes
+ * values, by parameter.
+ */
+G2DEC_Status readCubePoint(const char *filename, int point, float *values);
+
+/**
+ * Wind components at points in space and time, from WIND_U and WIND_V
+ * messages of forecast files.
+ *
+ * Fields are kept by valid time (reference time and forecast time), in
+ * float, and must have the same regular latitude / longitude grid. Only
+ * fields bracketing the time range are kept. Queries are interpolated
+ * bilinearly in space and linearly in time, by batches.
+ */
+class WindQuery {
+public:
+    /**
+     * Set level of wind fields (code table 4.5 type and value in meters or
+     * pascals), 10 m above ground (103, 10) by default. Fields already
+     * loaded are kept.
+     */
+    virtual void setLevel(int levelType, double level) = 0;
+
+    /**
+     * Set time range of queries, in seconds since 1970-01-01 00:00 UTC:
+     * fields that do not bracket a time of range are dropped, on loading
+     * and from fields already loaded. Whole time by default.
+     */
+    virtual void setTimeRange(double begin, double end) = 0;
+
+    /**
+     * Load wind fields of a file or stream. A field is available for
+     * queries when both components of its time are loaded.
+     *
+     * NOT_IMPLEMENTED is returned for grids other than regular latitude /
+     * longitude, ERROR if grid differs from grid of loaded fields. See
+     * getLastError().
+     */
+    virtual G2DEC_Status load(const char *filename) = 0;
+    virtual G2DEC_Status load(std::istream& fin) = 0;
+
+    /**
+     * Text of error of last load, or empty string.
+     */
+    virtual const char *getLastError() const = 0;
+
+    /**
+     * Get valid times of fields available for queries, in increasing order.
+     * Array is valid until next load.
+     */
+    virtual void getTimes(const double *&times, int& length) const = 0;
+
+    /**
+     * Interpolate wind components at points, in points order. u and v are
+     * NaN for points outside grid or outside times of fields.
+     *
+     * Queries can run concurrently, but not with load().
+     */
+    virtual G2DEC_Status query(const G2DEC_WindPoint *points, int nbPoints,
+                               double *u, double *v) const = 0;
+
+    /**
+     * Create an empty wind query engine.
+     */
+    static WindQuery *create();
+
+    //
+    virtual ~WindQuery() {}
+};
+
+/**
+ * Start recording a timeline of decoding, in all threads and decoders :
+ * messages, sections, data decoding and interpolation.
+ *
+ * Previous events are cleared. Call it when no decoding is running.
+ */
+void startTrace();
+
+/**
+ * Stop recording the timeline, and write it to filename in Chrome trace
+ * JSON format (chrome://tracing or Perfetto).
+ */
+G2DEC_Status stopTrace(const char *filename);
+
 } // grib2dec
 
 #endif
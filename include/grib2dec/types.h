@@ -18,6 +18,24 @@ typedef enum {
     G2DEC_STATUS_ERROR,
 } G2DEC_Status;
 
+/**
+ * Log level of decoding errors
+ */
+typedef enum {
+    G2DEC_LOG_NONE = 0,
+    /// malformed messages
+    G2DEC_LOG_ERROR,
+    /// messages skipped as they use unsupported features
+    G2DEC_LOG_WARNING,
+} G2DEC_LogLevel;
+
+/**
+ * Log callback, called for each decoding error up to log level.
+ * message is valid only during the call.
+ */
+typedef void (*G2DEC_LogCallback)(G2DEC_LogLevel level, G2DEC_Status status,
+                                  const char *message, void *userData);
+
 /**
  * Product discipline
  */
@@ -104,6 +122,69 @@ typedef struct G2DEC_SpatialFilter {
     double lonMax;
 } G2DEC_SpatialFilter;
 
+/**
+ * Decimation structure
+ *
+ * keep one point every strideI points along a parallel and every strideJ
+ * points along a meridian. A stride of 0 or 1 means no decimation.
+ *
+ * if average is not 0, kept value is the average of the strideI x strideJ
+ * box beginning at kept point.
+ */
+typedef struct G2DEC_Decimation {
+    int strideI;
+    int strideJ;
+    int average;
+} G2DEC_Decimation;
+
+/**
+ * Point structure, for point extraction
+ *
+ * latitude is in range [-90, 90]
+ * longitude is in degree, any range
+ */
+typedef struct G2DEC_Point {
+    double lat;
+    double lon;
+} G2DEC_Point;
+
+/**
+ * Interpolation of grid values at points
+ */
+typedef enum {
+    G2DEC_INTERPOLATION_NEAREST = 0,
+    G2DEC_INTERPOLATION_BILINEAR,
+} G2DEC_Interpolation;
+
+/**
+ * Group splitting of complex packing, when encoding
+ *
+ * fast splits values in groups of fixed length, compact chooses groups
+ * boundaries where values range changes, for smaller messages.
+ */
+typedef enum {
+    G2DEC_GROUP_SPLITTING_FAST = 0,
+    G2DEC_GROUP_SPLITTING_COMPACT,
+} G2DEC_GroupSplitting;
+
+/**
+ * Encoding options structure
+ */
+typedef struct G2DEC_EncodeOptions {
+    /// data representation template, 2 (complex packing) or 3 (complex
+    /// packing with spatial differencing)
+    int tpl;
+    /// order of spatial differencing for template 3, 1 or 2
+    int spatialOrder;
+    /// values are rounded to 10^-decimalScale
+    int decimalScale;
+    /// group splitting method
+    G2DEC_GroupSplitting groupSplitting;
+    /// groups length for fast splitting, maximum length for compact
+    /// splitting. 0 for default (32 and 256)
+    int groupLength;
+} G2DEC_EncodeOptions;
+
 /**
  * Date structure
  */
@@ -112,6 +193,114 @@ typedef struct G2DEC_Datetime {
     int hour, minute, second;
 } G2DEC_Datetime;
 
+/**
+ * Unit of time range (code table 4.4)
+ */
+typedef enum {
+    G2DEC_TIME_UNIT_MISSING = -1,
+
+    G2DEC_TIME_UNIT_MINUTE = 0,
+    G2DEC_TIME_UNIT_HOUR = 1,
+    G2DEC_TIME_UNIT_DAY = 2,
+    G2DEC_TIME_UNIT_MONTH = 3,
+    G2DEC_TIME_UNIT_YEAR = 4,
+    G2DEC_TIME_UNIT_DECADE = 5,
+    G2DEC_TIME_UNIT_NORMAL = 6,
+    G2DEC_TIME_UNIT_CENTURY = 7,
+    G2DEC_TIME_UNIT_3_HOURS = 10,
+    G2DEC_TIME_UNIT_6_HOURS = 11,
+    G2DEC_TIME_UNIT_12_HOURS = 12,
+    G2DEC_TIME_UNIT_SECOND = 13,
+} G2DEC_TimeUnit;
+
+/**
+ * Product definition structure, from templates 4.0, 4.1, 4.8 and 4.11
+ *
+ * fields which are missing or not in message template are -1.
+ */
+typedef struct G2DEC_Product {
+    /// product definition template
+    int tpl;
+    /// type of first fixed surface (code table 4.5), for instance 1 for
+    /// ground, 100 for isobaric surface, 103 for height above ground
+    int levelType;
+    /// value of first fixed surface, in unit of its type (Pa, m...)
+    double level;
+    /// second fixed surface, for layers
+    int levelType2;
+    double level2;
+    /// forecast time in timeUnit, from reference time. For statistics,
+    /// start of the time interval
+    int forecastTime;
+    G2DEC_TimeUnit timeUnit;
+    /// ensemble forecasts (4.1, 4.11): type of ensemble (code table 4.6),
+    /// perturbation number and number of forecasts in ensemble
+    int ensembleType;
+    int member;
+    int members;
+    /// statistics (4.8, 4.11): statistical process (code table 4.10, 0 for
+    /// average, 1 for accumulation, 2 for maximum, 3 for minimum) over an
+    /// interval of intervalLength in intervalUnit, ending at intervalEnd
+    int statistic;
+    int intervalLength;
+    G2DEC_TimeUnit intervalUnit;
+    G2DEC_Datetime intervalEnd;
+} G2DEC_Product;
+
+/**
+ * Selection of messages by product, a field of -1 matches any value
+ *
+ * level is compared only when levelType is set. forecastTime is compared
+ * in seconds when both units allow it: 6 hours selects 360 minutes.
+ */
+typedef struct G2DEC_Selection {
+    G2DEC_Parameter parameter;
+    int levelType;
+    double level;
+    int forecastTime;
+    G2DEC_TimeUnit timeUnit;
+    int member;
+    int statistic;
+} G2DEC_Selection;
+
+/**
+ * Projection of grids, value is grid definition template
+ */
+typedef enum {
+    /// latitude / longitude and gaussian grids
+    G2DEC_PROJECTION_NONE = 0,
+    /// polar stereographic grids (template 3.20)
+    G2DEC_PROJECTION_POLAR_STEREOGRAPHIC = 20,
+    /// lambert conformal grids (template 3.30)
+    G2DEC_PROJECTION_LAMBERT = 30,
+} G2DEC_ProjectionType;
+
+/**
+ * Projection structure, for projected grids
+ *
+ * grid points are regularly spaced in projection plane, from first point
+ * (lat1, lon1) of grid.
+ */
+typedef struct G2DEC_Projection {
+    G2DEC_ProjectionType type;
+    /// grid lengths in meter at latitude lad, dx is negative when rows
+    /// are scanned westward, dy is positive when scanned northward
+    double dx;
+    double dy;
+    /// latitude where dx and dy are specified
+    double lad;
+    /// orientation of the grid: longitude parallel to y axis
+    double lov;
+    /// latitudes where secant cone cuts the earth (lambert)
+    double latin1;
+    double latin2;
+    /// projection centre is south pole
+    int southPole;
+    /// southern pole of projection (lambert), kept to encode grid back
+    double latSouthPole;
+    double lonSouthPole;
+} G2DEC_Projection;
+
 /**
  * Grid definition structure
  */
@@ -130,12 +319,80 @@ typedef struct G2DEC_Grid {
     double lat1;
     /// latitude of last row
     double lat2;
-    /// angle increment for longitude
+    /// angle increment for longitude, 0 for projected grids
     double lonInc;
-    /// angle increment for latitude
+    /// angle increment for latitude, mean increment for gaussian grids,
+    /// 0 for projected grids
     double latInc;
+    /// gaussian grids (template 3.40): number of parallels between a pole
+    /// and the equator, 0 for regular grids
+    int gaussianN;
+    /// projected grids: limits are first and last points coordinates
+    G2DEC_Projection projection;
 } G2DEC_Grid;
 
+/**
+ * Region structure, for multi-region extraction
+ */
+typedef struct G2DEC_Region {
+    /// grid of the region, limits set accordingly to region filter
+    G2DEC_Grid grid;
+
+    /// values of the region, in raster order with limits defined in grid
+    double *values;
+    /// values number, should be grid.ni * grid.nj
+    int valuesLength;
+} G2DEC_Region;
+
+/**
+ * Decoding phases, for statistics
+ */
+typedef enum {
+    /// sections 0 to 6 and end section
+    G2DEC_PHASE_HEADERS = 0,
+    /// group references, widths and lengths of data section
+    G2DEC_PHASE_GROUPS,
+    /// values reconstruction of data section
+    G2DEC_PHASE_VALUES,
+    /// points and regrid interpolation
+    G2DEC_PHASE_INTERPOLATION,
+
+    G2DEC_PHASES_NUMBER
+} G2DEC_Phase;
+
+/**
+ * Counter of statistics : number of times, bytes read and time spent
+ */
+typedef struct G2DEC_Counter {
+    long long count;
+    long long bytes;
+    double seconds;
+} G2DEC_Counter;
+
+/**
+ * Decoding statistics structure, cumulated since decoder creation or
+ * last reset.
+ */
+typedef struct G2DEC_Stats {
+    /// 0 if library is built without statistics (GRIB2DEC_STATS option)
+    int enabled;
+
+    /// by section number, 0 (indicator) to 8 (end)
+    G2DEC_Counter sections[9];
+    /// by decoding phase
+    G2DEC_Counter phases[G2DEC_PHASES_NUMBER];
+
+    long long messages;
+    /// messages not matching selections, skipped before their data section
+    long long messagesSkipped;
+    long long bytesRead;
+    /// values kept in output
+    long long valuesDecoded;
+    /// values not kept, by spatial filter, decimation, regions or points
+    long long valuesSkipped;
+    long long seeks;
+} G2DEC_Stats;
+
 /**
  * Message structure
  */
@@ -144,14 +401,103 @@ typedef struct G2DEC_Message {
     G2DEC_Category category;
     G2DEC_Parameter parameter;
     G2DEC_Datetime datetime;
+    /// levels, forecast time, ensemble member and statistics
+    G2DEC_Product product;
     G2DEC_Grid grid;
+    /// identifier of grid definition in decoder, from 0: messages with the
+    /// same grid section have the same identifier
+    int gridId;
+    /// index of field in grib2 message, from 0: a message may carry several
+    /// fields with repeated sections 3 to 7, returned one by one
+    int field;
 
     /// values of paremeters, in raster order with limits defined in grid
+    /// (NaN for points missing in bitmap)
     double *values;
     /// values number, should be grid.ni * grid.nj
     int valuesLength;
+
+    /// regions, in the order they were set (empty if no region is set)
+    G2DEC_Region *regions;
+    /// regions number
+    int regionsLength;
+
+    /// values at points, in points order (NaN if point is outside grid)
+    double *pointValues;
+    /// points number
+    int pointValuesLength;
+
+    /// decimal scale keeping precision of packed values in message: decimal
+    /// scale factor D, with digits of binary scale factor E when E < 0
+    int decimalScale;
+
+    /// raw identification (1) and product definition (4) sections, with
+    /// their header, to write message back with encoding
+    const char *identificationSection;
+    int identificationSectionLength;
+    const char *productSection;
+    int productSectionLength;
 } G2DEC_Message;
 
+/**
+ * Options of time series cube building, see buildCube()
+ */
+typedef struct G2DEC_CubeOptions {
+    /// region of values, whole grid if min = max = 0
+    G2DEC_SpatialFilter region;
+    /// points by block of the transposition: memory used is about
+    /// 8 * blockPoints * parameters * times bytes. 0 for default (4096)
+    int blockPoints;
+    /// decoding threads, 0 for hardware concurrency
+    int threads;
+} G2DEC_CubeOptions;
+
+/**
+ * Time of a cube, from first message selected in its input file
+ */
+typedef struct G2DEC_CubeTime {
+    /// reference time of forecast
+    G2DEC_Datetime reference;
+    /// forecast time in seconds, -1 if unknown or no message selected
+    long long forecastSeconds;
+} G2DEC_CubeTime;
+
+/**
+ * Header of a time series cube file
+ *
+ * A cube file is the header, parameters selections (G2DEC_Selection
+ * [nbParameters]), times (G2DEC_CubeTime [nbTimes]), and from dataOffset,
+ * a multiple of 4096, float values [nbPoints][nbParameters][nbTimes]:
+ * time series of a point are contiguous. Points are values of grid in
+ * raster order, missing values are NaN.
+ *
+ * Structures and values are written in native byte order, so that a cube
+ * file can be memory-mapped.
+ */
+typedef struct G2DEC_CubeHeader {
+    /// "G2DCUBE"
+    char magic[8];
+    int version;
+    int nbParameters;
+    int nbTimes;
+    int nbPoints;
+    /// grid of values, limits set accordingly to region
+    G2DEC_Grid grid;
+    long long dataOffset;
+} G2DEC_CubeHeader;
+
+/**
+ * Point in space and time, for wind queries
+ *
+ * latitude is in range [-90, 90], longitude in degree, any range.
+ * time is valid time, in seconds since 1970-01-01 00:00 UTC.
+ */
+typedef struct G2DEC_WindPoint {
+    double lat;
+    double lon;
+    double time;
+} G2DEC_WindPoint;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,96 @@
+#include "coordinates.hpp"
+#include "gaussian.hpp"
+#include "points.hpp"
+#include "projection.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace grib2dec {
+namespace {
+
+// number of coordinates kept, see getLatitudes()
+const size_t cacheSize = 8;
+
+bool sameFilter(const Filter& a, const Filter& b)
+{
+    return a.i.front == b.i.front && a.i.back == b.i.back &&
+           a.j.front == b.j.front && a.j.back == b.j.back &&
+           a.decimation.strideI == b.decimation.strideI &&
+           a.decimation.strideJ == b.decimation.strideJ;
+}
+
+// kept indexes of n points, with skips and stride
+vector<int> keptIndexes(int n, const Filter::Skip& skip, int stride)
+{
+    vector<int> indexes;
+    for (int k = skip.front; k < n - skip.back; k += stride)
+        indexes.push_back(k);
+    return indexes;
+}
+
+void computeCoordinates(ValuesCoordinates& coordinates)
+{
+    const Grid& grid = coordinates.grid;
+    const Filter& filter = coordinates.filter;
+    const vector<int> is = keptIndexes(grid.ni, filter.i, filter.decimation.strideI);
+    const vector<int> js = keptIndexes(grid.nj, filter.j, filter.decimation.strideJ);
+
+    vector<double>& lats = coordinates.lats;
+    vector<double>& lons = coordinates.lons;
+
+    // each value of projected grids, from grid coordinates table
+    if (projected(grid)) {
+        if (is.empty() || js.empty())
+            return;
+
+        const auto table = gridCoordinates(grid);
+        lats.reserve(is.size() * js.size());
+        lons.reserve(is.size() * js.size());
+
+        for (int j : js) {
+            const size_t row = size_t(j) * grid.ni;
+            for (int i : is) {
+                lats.push_back(table->lats[row + i]);
+                lons.push_back(table->lons[row + i]);
+            }
+        }
+        return;
+    }
+
+    vector<double> rows;
+    gaussianRows(grid, rows);
+
+    for (int j : js)
+        lats.push_back(rows.empty() ? grid.lat1 + j * grid.latInc : rows[j]);
+
+    for (int i : is)
+        lons.push_back(grid.lon1 + i * grid.lonInc);
+}
+
+} // local namespace
+
+const ValuesCoordinates& CoordinatesCache::get(const Grid& grid,
+                                               const Filter& filter)
+{
+    for (size_t k = 0; k < cache.size(); k++) {
+        if (sameGrid(cache[k]->grid, grid) && sameFilter(cache[k]->filter, filter)) {
+            rotate(cache.begin(), cache.begin() + k, cache.begin() + k + 1);
+            return *cache.front();
+        }
+    }
+
+    unique_ptr<ValuesCoordinates> coordinates(new ValuesCoordinates);
+    coordinates->grid = grid;
+    coordinates->filter = filter;
+    computeCoordinates(*coordinates);
+
+    cache.insert(cache.begin(), move(coordinates));
+    if (cache.size() > cacheSize)
+        cache.pop_back();
+
+    return *cache.front();
+}
+
+} // grib2dec
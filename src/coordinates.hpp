@@ -0,0 +1,35 @@
+#ifndef __COORDINATES_HPP
+#define __COORDINATES_HPP
+
+#include "struct.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace grib2dec {
+
+/*
+ * Coordinates of the values of a grid definition with a filter: of rows
+ * and columns for latitude / longitude and gaussian grids, of each value
+ * for projected grids.
+ */
+struct ValuesCoordinates {
+    Grid grid;       // grid definition, before filter
+    Filter filter;   // skips and decimation
+    std::vector<double> lats;
+    std::vector<double> lons;
+};
+
+class CoordinatesCache {
+public:
+    // coordinates for a grid definition and a filter, computed once and
+    // kept until other ones are computed for a few grids or filters
+    const ValuesCoordinates& get(const Grid& grid, const Filter& filter);
+
+private:
+    std::vector<std::unique_ptr<ValuesCoordinates>> cache;  // last used first
+};
+
+} // grib2dec
+
+#endif
@@ -0,0 +1,331 @@
+#include "grib2dec/grib2dec.hpp"
+#include "points.hpp"
+#include "selection.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace grib2dec {
+
+/*
+ * Point-major time series cube.
+ *
+ * Input files are decoded by threads to a time-major scratch file, a
+ * slice of float values [point] by time and parameter. Slices are then
+ * read by blocks of points and transposed in cache by tiles, each block
+ * is appended to cube file as [point][parameter][time].
+ */
+
+namespace {
+
+const char cubeMagic[8] = "G2DCUBE";
+const int cubeVersion = 1;
+const int defaultBlockPoints = 4096;
+const long long dataAlignment = 4096;
+
+// tile of slices x points transposed in cache
+const int tileSize = 64;
+
+class CubeBuilder {
+public:
+    CubeBuilder(const char *const *inputs, int nbInputs,
+                const G2DEC_Selection *parameters, int nbParameters,
+                const G2DEC_CubeOptions& options, const string& scratchFile)
+        : inputs(inputs, inputs + nbInputs),
+          parameters(parameters, parameters + nbParameters),
+          options(options), scratchFile(scratchFile),
+          times(nbInputs), written(size_t(nbInputs) * nbParameters, 0)
+    {
+        for (G2DEC_CubeTime& time : times) {
+            time.reference = {0, 0, 0, 0, 0, 0};
+            time.forecastSeconds = -1;
+        }
+    }
+
+    // decodes inputs to scratch file, with threads
+    void decode() {
+        TraceScope trace("cube decoding");
+
+        if (!ofstream(scratchFile, ios_base::binary).is_open())
+            throw cube_error("cannot create " + scratchFile);
+
+        int nbThreads = options.threads > 0 ? options.threads
+                                            : thread::hardware_concurrency();
+        nbThreads = max(1, min<int>(nbThreads, inputs.size()));
+
+        vector<thread> threads;
+        for (int i = 0; i < nbThreads; i++)
+            threads.emplace_back([this]() { decodeFiles(); });
+        for (thread& t : threads)
+            t.join();
+
+        if (error)
+            rethrow_exception(error);
+        if (!gridSet)
+            throw cube_error("no message matches parameters");
+    }
+
+    // writes cube file, transposing scratch file by blocks of points
+    void transpose(const char *output) {
+        TraceScope trace("cube transpose");
+
+        const int nbTimes = times.size();
+        const int nbParameters = parameters.size();
+        const int nbSlices = nbTimes * nbParameters;
+        const int blockPoints = options.blockPoints > 0 ? options.blockPoints
+                                                        : defaultBlockPoints;
+
+        ofstream out(output, ios_base::binary);
+        if (!out.is_open())
+            throw cube_error(string("cannot open ") + output);
+
+        ifstream scratch(scratchFile, ios_base::binary);
+        if (!scratch.is_open())
+            throw cube_error("cannot open " + scratchFile);
+
+        writeHeader(out);
+
+        vector<float> slices(size_t(nbSlices) * blockPoints);
+        vector<float> block(size_t(blockPoints) * nbSlices);
+
+        for (int begin = 0; begin < nbPoints; begin += blockPoints) {
+            const int nb = min(blockPoints, nbPoints - begin);
+
+            // slice s of time t and parameter p is s = t * nbParameters + p
+            for (int s = 0; s < nbSlices; s++) {
+                float *slice = slices.data() + size_t(s) * blockPoints;
+                if (!written[s]) {
+                    fill(slice, slice + nb, NAN);
+                    continue;
+                }
+
+                scratch.seekg((size_t(s) * nbPoints + begin) * sizeof(float));
+                scratch.read((char*)slice, nb * sizeof(float));
+                if (!scratch)
+                    throw cube_error("cannot read " + scratchFile);
+            }
+
+            // values of a point by parameter, then time
+            for (int s0 = 0; s0 < nbSlices; s0 += tileSize) {
+                const int s1 = min(nbSlices, s0 + tileSize);
+                for (int k0 = 0; k0 < nb; k0 += tileSize) {
+                    const int k1 = min(nb, k0 + tileSize);
+                    for (int s = s0; s < s1; s++) {
+                        const size_t column = size_t(s % nbParameters) * nbTimes +
+                                              s / nbParameters;
+                        const float *src = slices.data() + size_t(s) * blockPoints;
+                        for (int k = k0; k < k1; k++)
+                            block[size_t(k) * nbSlices + column] = src[k];
+                    }
+                }
+            }
+
+            out.write((const char*)block.data(), size_t(nb) * nbSlices * sizeof(float));
+        }
+
+        if (!out)
+            throw cube_error(string("cannot write ") + output);
+    }
+
+private:
+    void decodeFiles() {
+        fstream scratch(scratchFile, ios_base::in | ios_base::out | ios_base::binary);
+        if (!scratch.is_open())
+            return setError(make_exception_ptr(cube_error("cannot open " + scratchFile)));
+
+        for (int t = nextInput++; t < int(inputs.size()) && !failed; t = nextInput++) {
+            try {
+                decodeFile(t, scratch);
+            } catch (const cube_error&) {
+                return setError(current_exception());
+            }
+        }
+    }
+
+    void decodeFile(int t, fstream& scratch) {
+        unique_ptr<Grib2Dec> decoder(Grib2Dec::create(inputs[t]));
+        if (!decoder)
+            throw cube_error(string("cannot open ") + inputs[t]);
+
+        decoder->setSpatialFilter(options.region);
+        decoder->setSelections(parameters.data(), parameters.size());
+
+        const int nbParameters = parameters.size();
+        int nbFound = 0;
+        vector<float> values;
+        G2DEC_Message message;
+        G2DEC_Status status;
+
+        while (nbFound < nbParameters &&
+               (status = decoder->nextMessage(message)) != G2DEC_STATUS_END) {
+            if (status != G2DEC_STATUS_OK)
+                continue;
+
+            // first parameter selecting message, and not found yet
+            int p = 0;
+            while (p < nbParameters &&
+                   (written[t * nbParameters + p] ||
+                    !matchesSelection(message.parameter, message.product, parameters[p])))
+                p++;
+
+            if (p == nbParameters || !message.values)
+                continue;
+
+            setGrid(message.grid, inputs[t]);
+            if (message.valuesLength != nbPoints)
+                throw cube_error(string("number of values of ") + inputs[t] +
+                                 " differs from grid");
+
+            if (nbFound == 0) {
+                times[t].reference = message.datetime;
+                times[t].forecastSeconds = forecastSeconds(message.product);
+            }
+
+            values.assign(message.values, message.values + message.valuesLength);
+            scratch.seekp((size_t(t) * nbParameters + p) * nbPoints * sizeof(float));
+            scratch.write((const char*)values.data(), values.size() * sizeof(float));
+            if (!scratch)
+                throw cube_error("cannot write " + scratchFile);
+
+            written[t * nbParameters + p] = 1;
+            nbFound++;
+        }
+    }
+
+    // grid of first message, same for all
+    void setGrid(const Grid& messageGrid, const char *input) {
+        lock_guard<mutex> lock(gridMutex);
+
+        if (!gridSet) {
+            grid = messageGrid;
+            nbPoints = grid.ni * grid.nj;
+            gridSet = true;
+        } else if (!sameGrid(grid, messageGrid)) {
+            throw cube_error(string("grid of ") + input + " differs from first grid");
+        }
+    }
+
+    // first error of threads, thrown after decoding
+    void setError(exception_ptr e) {
+        lock_guard<mutex> lock(gridMutex);
+        if (!error)
+            error = e;
+        failed = true;
+    }
+
+    void writeHeader(ofstream& out) {
+        G2DEC_CubeHeader header;
+        zero(header);
+        memcpy(header.magic, cubeMagic, sizeof(header.magic));
+        header.version = cubeVersion;
+        header.nbParameters = parameters.size();
+        header.nbTimes = times.size();
+        header.nbPoints = nbPoints;
+        header.grid = grid;
+
+        const long long headerSize = sizeof(header) +
+                                     parameters.size() * sizeof(G2DEC_Selection) +
+                                     times.size() * sizeof(G2DEC_CubeTime);
+        header.dataOffset = (headerSize + dataAlignment - 1) / dataAlignment * dataAlignment;
+
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)parameters.data(), parameters.size() * sizeof(G2DEC_Selection));
+        out.write((const char*)times.data(), times.size() * sizeof(G2DEC_CubeTime));
+        out << string(header.dataOffset - headerSize, '\0');
+    }
+
+    const vector<const char*> inputs;
+    const vector<G2DEC_Selection> parameters;
+    const G2DEC_CubeOptions options;
+    const string scratchFile;
+
+    // by input, slices written by input thread only
+    vector<G2DEC_CubeTime> times;
+    vector<char> written;
+
+    mutex gridMutex;
+    bool gridSet = false;
+    Grid grid;
+    int nbPoints = 0;
+
+    atomic<int> nextInput{0};
+    atomic<bool> failed{false};
+    exception_ptr error;
+};
+
+} // local namespace
+
+G2DEC_Status buildCube(const char *const *inputs, int nbInputs,
+                       const G2DEC_Selection *parameters, int nbParameters,
+                       const G2DEC_CubeOptions& options, const char *output,
+                       string *error)
+{
+    if (nbInputs <= 0 || nbParameters <= 0 || options.blockPoints < 0) {
+        if (error)
+            *error = "cube error: no input, no parameter or bad options";
+        return G2DEC_STATUS_ERROR;
+    }
+
+    const string scratchFile = string(output) + ".tmp";
+    CubeBuilder builder(inputs, nbInputs, parameters, nbParameters, options,
+                        scratchFile);
+
+    try {
+        builder.decode();
+        builder.transpose(output);
+    } catch (const cube_error& e) {
+        if (error)
+            *error = e.what();
+        remove(scratchFile.c_str());
+        return e.status();
+    }
+
+    remove(scratchFile.c_str());
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status readCubeHeader(const char *filename, G2DEC_CubeHeader& header)
+{
+    ifstream in(filename, ios_base::binary);
+    in.read((char*)&header, sizeof(header));
+
+    if (!in || memcmp(header.magic, cubeMagic, sizeof(cubeMagic)) ||
+        header.version != cubeVersion)
+        return G2DEC_STATUS_ERROR;
+
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status readCubePoint(const char *filename, int point, float *values)
+{
+    G2DEC_CubeHeader header;
+    if (readCubeHeader(filename, header) != G2DEC_STATUS_OK)
+        return G2DEC_STATUS_ERROR;
+
+    if (point < 0 || point >= header.nbPoints)
+        return G2DEC_STATUS_ERROR;
+
+    const size_t nbValues = size_t(header.nbParameters) * header.nbTimes;
+
+    ifstream in(filename, ios_base::binary);
+    in.seekg(header.dataOffset + point * nbValues * sizeof(float));
+    in.read((char*)values, nbValues * sizeof(float));
+
+    return in ? G2DEC_STATUS_OK : G2DEC_STATUS_ERROR;
+}
+
+} // grib2dec
@@ -1,5 +1,8 @@
 #include "data.hpp"
+#include "points.hpp"
+#include "trace.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -7,18 +10,19 @@ using namespace std;
 namespace grib2dec {
 namespace {
 
+/*
+ * Filter operations, called for each decoded value in scan order:
+ *  - addValue() tells if current value is kept,
+ *  - setValue() stores the kept value,
+ *  - ended() tells that no more value will be kept.
+ */
+
 class SpatialFilterOp {
 public:
-    SpatialFilterOp(const Message& message) {
-        const Filter& filter = message.filter;
-
-        skipBegin = filter.i.front + filter.j.front * message.grid.ni;
-        skipEnd = filter.i.back + filter.j.back * message.grid.ni;
-        skipI = filter.i.front + filter.i.back;
-        nbI = message.grid.ni - skipI;
-        nbJ = message.grid.nj - filter.j.front - filter.j.back;
-        skip = skipBegin;
-        nb = nbI;
+    SpatialFilterOp(const Message& message, vector<double>& values)
+        : SpatialFilterOp(message)
+    {
+        setOutput(values, nbI * nbJ);
     }
 
     bool addValue() {
@@ -43,16 +47,393 @@ public:
         }
     }
 
+    void setValue(double value) {
+        assert(out < outEnd);
+        *out++ = value;
+    }
+
     bool ended() const {
         return nb == 0 && nbJ == 0;
     }
 
-private:
+protected:
+    SpatialFilterOp(const Message& message) {
+        const Filter& filter = message.filter;
+
+        skipBegin = filter.i.front + filter.j.front * message.grid.ni;
+        skipEnd = filter.i.back + filter.j.back * message.grid.ni;
+        skipI = filter.i.front + filter.i.back;
+        nbI = message.grid.ni - skipI;
+        nbJ = message.grid.nj - filter.j.front - filter.j.back;
+        skip = skipBegin;
+        nb = nbI;
+    }
+
+    void setOutput(vector<double>& values, int size) {
+        values.resize(size);
+        out = values.data();
+        outEnd = out + values.size();
+    }
+
     int skipBegin, skipEnd, skipI;
     int nbI, nbJ;
     int skip, nb;
+    double *out, *outEnd;
+};
+
+/*
+ * Decimation on spatial filter output: keep a point every strideI columns
+ * and strideJ rows, or average the strideI x strideJ boxes.
+ */
+class DecimationOp : public SpatialFilterOp {
+public:
+    DecimationOp(const Message& message, vector<double>& values)
+        : SpatialFilterOp(message),
+          strideI(message.filter.decimation.strideI),
+          strideJ(message.filter.decimation.strideJ),
+          average(message.filter.decimation.average),
+          width(nbI), height(nbJ)
+    {
+        int decimatedI = (width + strideI - 1) / strideI;
+        int decimatedJ = (height + strideJ - 1) / strideJ;
+        setOutput(values, decimatedI * decimatedJ);
+
+        if (average) {
+            sums.assign(decimatedI, 0.);
+            counts.assign(decimatedI, 0);
+        }
+    }
+
+    bool addValue() {
+        if (!SpatialFilterOp::addValue())
+            return false;
+
+        // position in filtered area
+        if (++i == width) {
+            i = 0;
+            iPhase = 0;
+            box = 0;
+            j++;
+            if (++jPhase == strideJ)
+                jPhase = 0;
+        } else if (++iPhase == strideI) {
+            iPhase = 0;
+            box++;
+        }
+
+        return average || (iPhase == 0 && jPhase == 0);
+    }
+
+    void setValue(double value) {
+        if (!average)
+            return SpatialFilterOp::setValue(value);
+
+        sums[box] += value;
+        counts[box]++;
+
+        // last value of a boxes row
+        if (i == width - 1 && (jPhase == strideJ - 1 || j == height - 1)) {
+            for (size_t b = 0; b < sums.size(); b++) {
+                SpatialFilterOp::setValue(sums[b] / counts[b]);
+                sums[b] = 0.;
+                counts[b] = 0;
+            }
+        }
+    }
+
+private:
+    const int strideI, strideJ;
+    const bool average;
+    const int width, height;
+    int i = -1, j = 0;
+    int iPhase = -1, jPhase = 0;
+    int box = 0;
+    vector<double> sums;
+    vector<int> counts;
+};
+
+class RegionsOp {
+public:
+    RegionsOp(Message& message)
+        : regions(message.regions), ni(message.grid.ni), nj(message.grid.nj)
+    {
+        row.resize(ni);
+
+        for (Region& region : regions) {
+            const Filter& filter = region.filter;
+            int rni = ni - filter.i.front - filter.i.back;
+            int rnj = nj - filter.j.front - filter.j.back;
+            region.values.resize(rni * rnj);
+            if (rni > 0 && rnj > 0)
+                lastRow = max(lastRow, filter.j.front + rnj - 1);
+        }
+
+        setRow();
+    }
+
+    bool addValue() {
+        if (++i == ni) {
+            i = 0;
+            j++;
+            setRow();
+        }
+        return i >= begin && i < end;
+    }
+
+    void setValue(double value) {
+        row[i] = value;
+        if (i == end - 1)
+            scatterRow();
+    }
+
+    bool ended() const {
+        return j > lastRow;
+    }
+
+private:
+    // columns to keep for current row: union of regions covering it
+    void setRow() {
+        begin = ni;
+        end = 0;
+        for (const Region& region : regions) {
+            const Filter& filter = region.filter;
+            if (covers(region, j)) {
+                begin = min(begin, filter.i.front);
+                end = max(end, ni - filter.i.back);
+            }
+        }
+    }
+
+    bool covers(const Region& region, int y) const {
+        return y >= region.filter.j.front && y < nj - region.filter.j.back;
+    }
+
+    void scatterRow() {
+        for (Region& region : regions) {
+            if (!covers(region, j))
+                continue;
+
+            const Filter& filter = region.filter;
+            int rni = ni - filter.i.front - filter.i.back;
+            copy_n(row.data() + filter.i.front, rni,
+                   region.values.data() + (j - filter.j.front) * rni);
+        }
+    }
+
+    vector<Region>& regions;
+    vector<double> row;
+    int ni, nj;
+    int i = -1, j = 0;
+    int begin, end;
+    int lastRow = -1;
+};
+
+/*
+ * Boustrophedon scanning, in raster: every other row is scanned in
+ * opposite direction. Rows are buffered and given to the filter
+ * operation in raster order.
+ */
+template <class FilterOp>
+class BoustrophedonOp {
+public:
+    BoustrophedonOp(const Message& message, FilterOp& filterOp)
+        : filterOp(filterOp), row(message.grid.ni) {}
+
+    bool addValue() {
+        return !filterOp.ended();
+    }
+
+    void setValue(double value) {
+        row[i++] = value;
+        if (i < int(row.size()))
+            return;
+
+        if (reversed)
+            reverse(row.begin(), row.end());
+
+        for (double v : row) {
+            if (filterOp.addValue())
+                filterOp.setValue(v);
+        }
+
+        i = 0;
+        reversed = !reversed;
+    }
+
+    bool ended() const {
+        return filterOp.ended();
+    }
+
+private:
+    FilterOp& filterOp;
+    vector<double> row;
+    int i = 0;
+    bool reversed = false;
+};
+
+/*
+ * Column-major scanning: spatial filter window is decoded by tiles of
+ * columns, and each tile is transposed by blocks of rows to raster
+ * output, so that tile and output blocks stay in cache. Every other
+ * column is reversed with boustrophedon scanning.
+ */
+class ColumnMajorOp {
+public:
+    static constexpr int tileColumns = 8;  // a cache line of output
+    static constexpr int blockRows = 64;
+
+    ColumnMajorOp(const Message& message, vector<double>& values)
+        : ni(message.grid.ni), nj(message.grid.nj),
+          boustrophedon(message.boustrophedon)
+    {
+        const Filter& filter = message.filter;
+        iBegin = filter.i.front;
+        iEnd = ni - filter.i.back;
+        jBegin = filter.j.front;
+        jEnd = nj - filter.j.back;
+        nbI = max(0, iEnd - iBegin);
+        nbJ = max(0, jEnd - jBegin);
+
+        values.resize(size_t(nbI) * nbJ);
+        out = values.data();
+        tile.resize(size_t(tileColumns) * nbJ);
+        done = nbI == 0 || nbJ == 0;
+    }
+
+    int width() const {
+        return nbI;
+    }
+
+    int height() const {
+        return nbJ;
+    }
+
+    bool addValue() {
+        if (++j == nj) {
+            j = 0;
+            i++;
+        }
+
+        reversed = boustrophedon && (i & 1);
+        row = reversed ? nj - 1 - j : j;
+        return i >= iBegin && i < iEnd && row >= jBegin && row < jEnd;
+    }
+
+    void setValue(double value) {
+        const int column = (i - iBegin) % tileColumns;
+        tile[size_t(column) * nbJ + row - jBegin] = value;
+
+        // last value of column in window
+        if (row != (reversed ? jBegin : jEnd - 1))
+            return;
+
+        if (column == tileColumns - 1 || i == iEnd - 1)
+            flushTile(i - iBegin - column, column + 1);
+
+        done = i == iEnd - 1;
+    }
+
+    bool ended() const {
+        return done;
+    }
+
+private:
+    // blocked transpose of tile columns to output rows
+    void flushTile(int tileBegin, int columns) {
+        for (int j0 = 0; j0 < nbJ; j0 += blockRows) {
+            const int j1 = min(nbJ, j0 + blockRows);
+            for (int r = j0; r < j1; r++) {
+                double *dst = out + size_t(r) * nbI + tileBegin;
+                const double *src = tile.data() + r;
+                for (int c = 0; c < columns; c++)
+                    dst[c] = src[size_t(c) * nbJ];
+            }
+        }
+    }
+
+    const int ni, nj;
+    const bool boustrophedon;
+    int iBegin, iEnd, jBegin, jEnd;
+    int nbI, nbJ;
+    int i = 0, j = -1;
+    int row = 0;
+    bool reversed = false;
+    bool done;
+    vector<double> tile;
+    double *out;
 };
 
+/*
+ * Bitmap of present points: packed values are given to the scan operation
+ * at their point, and missing points are NaN.
+ */
+template <class ScanOp>
+class BitmapOp {
+public:
+    BitmapOp(const Message& message, ScanOp& scanOp)
+        : scanOp(scanOp), bitmap(message.bitmap.data()),
+          nbPoints(size_t(message.grid.ni) * message.grid.nj) {}
+
+    bool addValue() {
+        addMissing();
+        point++;
+        return scanOp.addValue();
+    }
+
+    void setValue(double value) {
+        scanOp.setValue(value);
+    }
+
+    bool ended() const {
+        return scanOp.ended();
+    }
+
+    // missing points after last value
+    void end() {
+        addMissing();
+    }
+
+private:
+    // missing points up to next present one
+    void addMissing() {
+        while (point < nbPoints && !(bitmap[point >> 3] & (0x80 >> (point & 7)))) {
+            if (scanOp.addValue())
+                scanOp.setValue(NAN);
+            point++;
+        }
+    }
+
+    ScanOp& scanOp;
+    const uint8_t *bitmap;
+    const size_t nbPoints;
+    size_t point = 0;
+};
+
+// number of points present in bitmap
+size_t bitmapPoints(const vector<uint8_t>& bitmap, size_t nbPoints)
+{
+    size_t nb = 0;
+    for (size_t k = 0; k < nbPoints / 8; k++)
+        nb += __builtin_popcount(bitmap[k]);
+
+    if (nbPoints % 8)
+        nb += __builtin_popcount(bitmap[nbPoints / 8] & (0xff00 >> (nbPoints % 8)));
+
+    return nb;
+}
+
+// feeds filter operation with values in raster order
+template <class FilterOp>
+void replay(const vector<double>& values, FilterOp& filterOp)
+{
+    for (double value : values) {
+        if (filterOp.addValue())
+            filterOp.setValue(value);
+        else if (filterOp.ended())
+            break;
+    }
+}
+
 void readDataBits(Stream& stream, int nbBits, vector<int>& data)
 {
     for (auto& v : data)
@@ -68,13 +449,57 @@ void getScaleParameters(const Packing& pack, double& ref, double& scale)
     scale = pow(2., pack.E) * dscale;
 }
 
-template <int spatialOrder>
+class PointsOp {
+public:
+    PointsOp(const Message& message, vector<double>& values)
+        : weights(*message.pointWeights), ni(message.grid.ni)
+    {
+        values.resize(weights.rows.size() * ni);
+        out = values.data();
+        lastRow = weights.rows.empty() ? -1 : weights.rows.back();
+        setRow();
+    }
+
+    bool addValue() {
+        if (++i == ni) {
+            i = 0;
+            j++;
+            setRow();
+        }
+        return keepRow;
+    }
+
+    void setValue(double value) {
+        *out++ = value;
+    }
+
+    bool ended() const {
+        return j > lastRow;
+    }
+
+private:
+    void setRow() {
+        keepRow = j <= lastRow && weights.rowSlots[j] >= 0;
+    }
+
+    const PointWeights& weights;
+    int ni;
+    int i = -1, j = 0;
+    int lastRow;
+    bool keepRow;
+    double *out;
+};
+
+template <int spatialOrder, class FilterOp>
 void readComplexPackingValues(Stream& stream, const Message& message, int h1,
-                              int h2, int hmin, vector<double>& values)
+                              int h2, int hmin, FilterOp& filterOp)
 {
     static_assert(spatialOrder >= 0 && spatialOrder <= 2);
     const Packing& pack = message.packing;
 
+    STATS(PhaseTimer groupsTimer(stream.stats, G2DEC_PHASE_GROUPS);)
+    TraceScope groupsTrace("data groups");
+
     // group references
     vector<int> refs(pack.NG);
     readDataBits(stream, pack.sampleBits, refs);
@@ -93,6 +518,12 @@ void readComplexPackingValues(Stream& stream, const Message& message, int h1,
             v = v * inc + ref;
     }
 
+    STATS(groupsTimer.end();)
+    groupsTrace.end();
+    TraceScope valuesTrace("data values");
+    STATS(PhaseTimer valuesTimer(stream.stats, G2DEC_PHASE_VALUES);)
+    STATS(long long kept = 0;)
+
     // scale parameters
     double ref, scale;
     getScaleParameters(pack, ref, scale);
@@ -103,16 +534,6 @@ void readComplexPackingValues(Stream& stream, const Message& message, int h1,
     int nbBits = widths[groupId];
     int sampleId = 0;
     int groupRef = refs[groupId];
-    int valueId = 0;
-
-    const Filter& filter = message.filter;
-    int nbValues = (message.grid.ni - filter.i.front - filter.i.back) *
-                   (message.grid.nj - filter.j.front - filter.j.back);
-
-    // spatial filter
-    SpatialFilterOp filterOp(message);
-
-    values.resize(nbValues);
 
     for (int i = 0; i < spatialOrder; i++) {
         // read first values for nothing
@@ -124,8 +545,10 @@ void readComplexPackingValues(Stream& stream, const Message& message, int h1,
             x = h2;
 
         // spatial filter
-        if (filterOp.addValue())
-            values[valueId++] = ref + scale * x;
+        if (filterOp.addValue()) {
+            filterOp.setValue(ref + scale * x);
+            STATS(kept++;)
+        }
 
         // group management
         sampleId++;
@@ -154,8 +577,8 @@ void readComplexPackingValues(Stream& stream, const Message& message, int h1,
 
         // spatial filter
         if (filterOp.addValue()) {
-            assert(valueId < int(values.size()));
-            values[valueId++] = ref + scale * x;
+            filterOp.setValue(ref + scale * x);
+            STATS(kept++;)
         } else if (filterOp.ended()) {
             break;
         }
@@ -172,10 +595,98 @@ void readComplexPackingValues(Stream& stream, const Message& message, int h1,
             groupRef = refs[groupId];
         }
     }
+
+    STATS(if (stream.stats) {
+        stream.stats->valuesDecoded += kept;
+        stream.stats->valuesSkipped += pack.nbValues - kept;
+    })
+}
+
+template <class FilterOp>
+void readComplexPackingValues(Stream& stream, const Message& message, int h1,
+                              int h2, int hmin, FilterOp& filterOp)
+{
+    switch (message.packing.spatialOrder) {
+    case 0:
+        // template 5.2
+        return readComplexPackingValues<0>(stream, message, h1, h2, hmin, filterOp);
+    case 1:
+        // template 5.3
+        return readComplexPackingValues<1>(stream, message, h1, h2, hmin, filterOp);
+    case 2:
+        // template 5.3
+        return readComplexPackingValues<2>(stream, message, h1, h2, hmin, filterOp);
+    }
+}
+
+// values in scan order, with missing points of bitmap
+template <class ScanOp>
+void readScanValues(Stream& stream, const Message& message, int h1, int h2,
+                    int hmin, ScanOp& scanOp)
+{
+    if (message.useBitmap) {
+        BitmapOp<ScanOp> bitmapOp(message, scanOp);
+        readComplexPackingValues(stream, message, h1, h2, hmin, bitmapOp);
+        bitmapOp.end();
+    } else {
+        readComplexPackingValues(stream, message, h1, h2, hmin, scanOp);
+    }
+}
+
+// raster scanning, with rows reordered for boustrophedon
+template <class FilterOp>
+void readRasterValues(Stream& stream, const Message& message, int h1, int h2,
+                      int hmin, FilterOp& filterOp)
+{
+    if (message.boustrophedon) {
+        BoustrophedonOp<FilterOp> scanOp(message, filterOp);
+        readScanValues(stream, message, h1, h2, hmin, scanOp);
+    } else {
+        readScanValues(stream, message, h1, h2, hmin, filterOp);
+    }
+}
+
+/*
+ * Column-major scanning: spatial filter window is transposed while
+ * decoding. Points, regions and decimation, less frequent, replay the
+ * transposed window.
+ */
+void readColumnMajorValues(Stream& stream, Message& message, int h1, int h2,
+                           int hmin, vector<double>& values)
+{
+    const bool decimation = message.filter.decimation.strideI > 1 ||
+                            message.filter.decimation.strideJ > 1;
+
+    if (!message.pointWeights && message.regions.empty() && !decimation) {
+        ColumnMajorOp scanOp(message, values);
+        readScanValues(stream, message, h1, h2, hmin, scanOp);
+        return;
+    }
+
+    vector<double> window;
+    ColumnMajorOp scanOp(message, window);
+    readScanValues(stream, message, h1, h2, hmin, scanOp);
+
+    if (message.pointWeights) {
+        PointsOp filterOp(message, values);
+        replay(window, filterOp);
+    } else if (!message.regions.empty()) {
+        RegionsOp filterOp(message);
+        replay(window, filterOp);
+    } else {
+        // decimation of the window alone
+        Message windowMessage;
+        windowMessage.grid.ni = scanOp.width();
+        windowMessage.grid.nj = scanOp.height();
+        windowMessage.filter.decimation = message.filter.decimation;
+
+        DecimationOp filterOp(windowMessage, values);
+        replay(window, filterOp);
+    }
 }
 
 template <int tpl>
-void readDataTemplate(Stream& stream, const Message& message, vector<double>& values)
+void readDataTemplate(Stream& stream, Message& message, vector<double>& values)
 {
     static_assert(tpl == 2 || tpl == 3);
     const Packing& pack = message.packing;
@@ -200,21 +711,24 @@ void readDataTemplate(Stream& stream, const Message& message, vector<double>& va
         assert(pack.spatialOrder == 0);
     }
 
-    // read values with complex packing
+    // read values with complex packing, filtered by points, regions or
+    // spatial filter
 
-    switch (pack.spatialOrder) {
-    case 0:
-        // template 5.2
-        readComplexPackingValues<0>(stream, message, h1, h2, hmin, values);
-        break;
-    case 1:
-        // template 5.3
-        readComplexPackingValues<1>(stream, message, h1, h2, hmin, values);
-        break;
-    case 2:
-        // template 5.3
-        readComplexPackingValues<2>(stream, message, h1, h2, hmin, values);
-        break;
+    if (message.columnMajor) {
+        readColumnMajorValues(stream, message, h1, h2, hmin, values);
+    } else if (message.pointWeights) {
+        PointsOp filterOp(message, values);
+        readRasterValues(stream, message, h1, h2, hmin, filterOp);
+    } else if (!message.regions.empty()) {
+        RegionsOp filterOp(message);
+        readRasterValues(stream, message, h1, h2, hmin, filterOp);
+    } else if (message.filter.decimation.strideI > 1 ||
+               message.filter.decimation.strideJ > 1) {
+        DecimationOp filterOp(message, values);
+        readRasterValues(stream, message, h1, h2, hmin, filterOp);
+    } else {
+        SpatialFilterOp filterOp(message, values);
+        readRasterValues(stream, message, h1, h2, hmin, filterOp);
     }
 
     stream.sectionEnd();
@@ -224,15 +738,28 @@ void readDataTemplate(Stream& stream, const Message& message, vector<double>& va
 
 void readData(Stream& stream, Message& message, vector<double>& values)
 {
+    TraceScope trace("data decoding");
     values.clear();
 
+    const size_t nbPoints = size_t(message.grid.ni) * message.grid.nj;
+
+    if (!message.useBitmap && size_t(message.packing.nbValues) != nbPoints)
+        throw parsing_error("number of point is not ni x nj");
+
+    if (message.useBitmap) {
+        if (message.bitmap.size() * 8 < nbPoints)
+            throw parsing_error("bitmap is smaller than grid");
+        if (size_t(message.packing.nbValues) != bitmapPoints(message.bitmap, nbPoints))
+            throw parsing_error("number of point is not bitmap points");
+    }
+
     switch (message.packing.tpl) {
     case 2:
         return readDataTemplate<2>(stream, message, values);
     case 3:
         return readDataTemplate<3>(stream, message, values);
     default:
-        throw not_implemented("data template not handled");
+        return unsupported(message, "data template not handled");
     }
 }
 
@@ -1,36 +1,200 @@
 #include "decoder.hpp"
+#include "projection.hpp"
 #include "sections.hpp"
 #include "struct.hpp"
+#include "trace.hpp"
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <string.h>
 
 using namespace std;
 
 namespace grib2dec {
 namespace {
 
-void readMessage(istream& fin, Message& message, vector<double>& values)
+// recovery mode: input scanned by blocks for next message
+const size_t resyncBlockSize = 1 << 20;
+const int indicatorLen = 16;
+
+bool isIndicator(const char *data)
+{
+    return memcmp(data, "GRIB", 4) == 0 && data[7] == 2;
+}
+
+// end section where message length says
+bool checkEndSection(istream& fin, size_t pos, uint64_t len)
+{
+    if (len < indicatorLen + 4)
+        return false;
+
+    char end[4];
+    fin.clear();
+    fin.seekg(pos + len - 4);
+    fin.read(end, 4);
+    return fin && memcmp(end, "7777", 4) == 0;
+}
+
+bool validMessage(istream& fin, size_t pos)
+{
+    char indicator[indicatorLen];
+    fin.clear();
+    fin.seekg(pos);
+    fin.read(indicator, indicatorLen);
+
+    return fin && isIndicator(indicator) &&
+           checkEndSection(fin, pos, len64(indicator + 8));
+}
+
+/*
+ * Position of next valid message from pos, or -1. Blocks are scanned with
+ * memchr for GRIB magic, then edition and end section are checked.
+ */
+int64_t findMessage(istream& fin, size_t pos)
+{
+    vector<char> block(resyncBlockSize + indicatorLen - 1);
+
+    while (true) {
+        fin.clear();
+        fin.seekg(pos);
+        fin.read(block.data(), block.size());
+
+        const size_t nbRead = fin.gcount();
+        if (nbRead < size_t(indicatorLen))
+            return -1;
+
+        // candidates with whole indicator section in block
+        const char *begin = block.data();
+        const char *end = begin + nbRead - indicatorLen + 1;
+
+        for (const char *p = begin; (p = (const char*)memchr(p, 'G', end - p)); p++) {
+            if (isIndicator(p) && checkEndSection(fin, pos + (p - begin), len64(p + 8)))
+                return pos + (p - begin);
+        }
+
+        pos += end - begin;
+    }
+}
+
+Grid filteredGrid(const Grid& grid, const vector<double>& latitudes,
+                  const Filter& filter)
 {
+    Grid output = grid;
+    output.ni -= filter.i.front + filter.i.back;
+    output.nj -= filter.j.front + filter.j.back;
+
+    // decimation
+    const int strideI = filter.decimation.strideI;
+    const int strideJ = filter.decimation.strideJ;
+
+    if (strideI > 1) {
+        output.ni = (output.ni + strideI - 1) / strideI;
+        output.lonInc *= strideI;
+        output.lon2 = output.lon1 + (output.ni - 1) * output.lonInc;
+    }
+
+    if (strideJ > 1) {
+        output.nj = (output.nj + strideJ - 1) / strideJ;
+        output.latInc *= strideJ;
+        output.lat2 = output.lat1 + (output.nj - 1) * output.latInc;
+    }
+
+    // gaussian rows are not regular, latitude increment is the mean one
+    if (grid.gaussianN && output.nj > 0 && output.ni > 0) {
+        output.lat1 = latitudes[filter.j.front];
+        output.lat2 = latitudes[filter.j.front + (output.nj - 1) * strideJ];
+        output.latInc = output.nj > 1 ? (output.lat2 - output.lat1) / (output.nj - 1) : 0.;
+
+        // decimated rows are not consecutive gaussian latitudes
+        if (strideJ > 1)
+            output.gaussianN = 0;
+    }
+
+    // projected grids: decimation is on grid lengths
+    if (projected(grid) && output.nj > 0 && output.ni > 0) {
+        output.projection.dx *= strideI;
+        output.projection.dy *= strideJ;
+        if (strideI > 1 || strideJ > 1)
+            gridPoint(output, output.ni - 1, output.nj - 1, output.lat2, output.lon2);
+    }
+
+    return output;
+}
+
+// a field is read, and others follow in message
+bool hasMoreFields(const Message& message)
+{
+    return message.fieldEnd && !message.complete &&
+           message.lenRead + 4 < message.len;
+}
+
+// state of previous field kept for next one: grid, filters and bitmap
+void nextField(Message& message)
+{
+    message.field++;
+    message.fieldEnd = false;
+    message.skipped = false;
+    message.useBitmap = false;
+    message.product = missingProduct();
+    message.packing = Packing();
+    message.filter = Filter();
+    message.points = nullptr;
+}
+
+/*
+ * Reads next field of message, up to its data section, or end section
+ * after last field. First field begins with indicator section, next ones
+ * with sections 3 to 7 repeated and grid of previous field.
+ */
+void readField(istream& fin, Message& message, vector<double>& values,
+               G2DEC_Stats& stats)
+{
+    TraceScope trace("message");
     Stream stream(fin);
+    STATS(stream.stats = &stats;)
     values.clear();
 
-    readIndicatorSection(stream, message);
+    if (message.field == 0)
+        readIndicatorSection(stream, message);
+    else
+        reuseGridSection(message);
 
-    while (!message.complete && message.lenRead < message.len)
+    while (!message.complete && message.lenRead < message.len &&
+           !message.error && !hasMoreFields(message))
         readSection(stream, message, values);
 }
 
+/*
+ * Decimal scale keeping precision of packed values: values are multiples
+ * of 2^E 10^-D, a binary scale E < 0 adds digits to D.
+ */
+int decimalScale(const Packing& packing)
+{
+    if (packing.E >= 0)
+        return packing.D;
+    return packing.D + int(ceil(-packing.E * log10(2.)));
+}
+
 void convertMessage(const Message& message, G2DEC_Message& output)
 {
     output.datetime = message.datetime;
     output.discipline = message.discipline;
     output.category = message.category;
     output.parameter = message.parameter;
-    output.grid = message.grid;
+    output.product = message.product;
+    output.grid = filteredGrid(message.grid, message.latitudes, message.filter);
+    output.gridId = message.gridId;
+    output.field = message.field;
+    output.decimalScale = decimalScale(message.packing);
+}
 
-    output.grid.ni -= message.filter.i.front + message.filter.i.back;
-    output.grid.nj -= message.filter.j.front + message.filter.j.back;
+void convertRegion(Region& region, const vector<double>& latitudes,
+                   G2DEC_Region& output)
+{
+    output.grid = filteredGrid(region.grid, latitudes, region.filter);
+    output.values = region.values.data();
+    output.valuesLength = region.values.size();
 }
 
 } // local namespace
@@ -39,12 +203,16 @@ Decoder::Decoder(istream& fin)
     : fin(fin)
 {
     zero(spatialFilter);
+    zero(regridGrid);
+    zero(stats);
 }
 
 Decoder::Decoder(const char *filename)
     : fin(fileStream)
 {
     zero(spatialFilter);
+    zero(regridGrid);
+    zero(stats);
     fileStream.open(filename, ios_base::in | ios_base::binary);
     if (!fileStream.is_open())
         throw file_open_error();
@@ -56,37 +224,214 @@ G2DEC_Status Decoder::setSpatialFilter(const G2DEC_SpatialFilter& filter)
         return G2DEC_STATUS_ERROR;
 
     spatialFilter = filter;
+    grids.invalidate();
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status Decoder::setDecimation(const G2DEC_Decimation& newDecimation)
+{
+    if (newDecimation.strideI < 0 || newDecimation.strideJ < 0)
+        return G2DEC_STATUS_ERROR;
+
+    decimation = newDecimation;
+    decimation.strideI = max(decimation.strideI, 1);
+    decimation.strideJ = max(decimation.strideJ, 1);
+    grids.invalidate();
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status Decoder::setRegions(const G2DEC_SpatialFilter *filters,
+                                 int nbRegions)
+{
+    if (nbRegions < 0)
+        return G2DEC_STATUS_ERROR;
+
+    for (int i = 0; i < nbRegions; i++) {
+        const G2DEC_SpatialFilter& filter = filters[i];
+        if (filter.latMin > filter.latMax || filter.lonMin > filter.lonMax)
+            return G2DEC_STATUS_ERROR;
+    }
+
+    regions.resize(nbRegions);
+    regionsOutput.resize(nbRegions);
+
+    for (int i = 0; i < nbRegions; i++)
+        regions[i].filter.spatialFilter = filters[i];
+
+    grids.invalidate();
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status Decoder::setPoints(const G2DEC_Point *newPoints, int nbPoints,
+                                G2DEC_Interpolation interpolation)
+{
+    if (nbPoints < 0)
+        return G2DEC_STATUS_ERROR;
+
+    if (interpolation != G2DEC_INTERPOLATION_NEAREST &&
+        interpolation != G2DEC_INTERPOLATION_BILINEAR)
+        return G2DEC_STATUS_ERROR;
+
+    points.set(newPoints, nbPoints, interpolation);
+    grids.invalidate();
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status Decoder::setRegrid(const G2DEC_Grid& target,
+                                G2DEC_Interpolation interpolation)
+{
+    if (target.ni < 0 || target.nj < 0)
+        return G2DEC_STATUS_ERROR;
+
+    if (interpolation != G2DEC_INTERPOLATION_NEAREST &&
+        interpolation != G2DEC_INTERPOLATION_BILINEAR)
+        return G2DEC_STATUS_ERROR;
+
+    if (target.ni == 0 || target.nj == 0) {
+        regrid.set(nullptr, 0, interpolation);
+        zero(regridGrid);
+        grids.invalidate();
+        return G2DEC_STATUS_OK;
+    }
+
+    Grid grid = target;
+    grid.lon2 = grid.lon1 + (grid.ni - 1) * grid.lonInc;
+    grid.gaussianN = 0;
+    grid.projection = {};
+    grid.lat2 = grid.lat1 + (grid.nj - 1) * grid.latInc;
+
+    // same target keeps weights cache
+    if (sameGrid(grid, regridGrid) && interpolation == regridInterpolation)
+        return G2DEC_STATUS_OK;
+
+    vector<G2DEC_Point> gridPoints(size_t(grid.ni) * grid.nj);
+    auto point = gridPoints.begin();
+
+    for (int j = 0; j < grid.nj; j++) {
+        for (int i = 0; i < grid.ni; i++, ++point) {
+            point->lat = grid.lat1 + j * grid.latInc;
+            point->lon = grid.lon1 + i * grid.lonInc;
+        }
+    }
+
+    regrid.set(gridPoints.data(), gridPoints.size(), interpolation);
+    regridGrid = grid;
+    regridInterpolation = interpolation;
+    grids.invalidate();
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status Decoder::setSelections(const G2DEC_Selection *newSelections,
+                                    int nbSelections)
+{
+    if (nbSelections < 0)
+        return G2DEC_STATUS_ERROR;
+
+    selections.assign(newSelections, newSelections + nbSelections);
     return G2DEC_STATUS_OK;
 }
 
 G2DEC_Status Decoder::nextMessage(G2DEC_Message& output)
 {
-    zero(output);
+    G2DEC_Status status;
+    bool skipped;
+
+    do
+        status = readNextMessage(output, skipped);
+    while (skipped);
 
-    if (ended)
-        return G2DEC_STATUS_END;
+    return status;
+}
 
-    fin.seekg(nextMessagePos, ios_base::beg);
+G2DEC_Status Decoder::readNextMessage(G2DEC_Message& output, bool& skipped)
+{
+    zero(output);
+    skipped = false;
 
-    // test end of file
-    {
-        char c = fin.get();
-        if (fin.eof()) {
-            ended = true;
+    if (moreFields) {
+        // next field of current message
+        fin.clear();
+        fin.seekg(nextMessagePos + message.lenRead, ios_base::beg);
+        STATS(stats.seeks++;)
+        nextField(message);
+        moreFields = false;
+    } else {
+        if (ended)
             return G2DEC_STATUS_END;
+
+        if (recovery && !validMessage(fin, nextMessagePos)) {
+            const int64_t pos = findMessage(fin, nextMessagePos + 1);
+            fin.clear();
+
+            if (pos < 0) {
+                // garbage or truncated message at end
+                fin.seekg(0, ios_base::end);
+                if (size_t(fin.tellg()) > nextMessagePos)
+                    log(G2DEC_LOG_ERROR, G2DEC_STATUS_PARSE_ERROR, "recovery: ",
+                        "no valid message until end of input");
+                ended = true;
+                return G2DEC_STATUS_END;
+            }
+
+            log(G2DEC_LOG_ERROR, G2DEC_STATUS_PARSE_ERROR, "recovery: ",
+                (to_string(pos - nextMessagePos) + " bytes skipped before message").c_str());
+            nextMessagePos = pos;
         }
-        fin.putback(c);
+
+        fin.seekg(nextMessagePos, ios_base::beg);
+        STATS(stats.seeks++;)
+
+        // test end of file
+        {
+            char c = fin.get();
+            if (fin.eof()) {
+                ended = true;
+                return G2DEC_STATUS_END;
+            }
+            fin.putback(c);
+        }
+
+        message = Message();
+        message.grids = &grids;
     }
 
-    Message message;
-    message.filter.spatialFilter = spatialFilter;
+    message.selections = !selections.empty() ? &selections : nullptr;
+    lastValues = false;
+    lastRegionFilters.clear();
+
+    /* points replace regrid, regrid replaces regions, and regions replace
+     * the spatial filter.
+     * Regions are swapped with message to keep buffers between messages.
+     */
+    PointsQuery *query = !points.empty() ? &points
+                         : !regrid.empty() ? &regrid : nullptr;
+    const bool withRegions = !query && !regions.empty();
+
+    if (query) {
+        zero(message.filter.spatialFilter);
+        message.points = query;
+    } else if (withRegions) {
+        zero(message.filter.spatialFilter);
+        for (Region& region : regions)
+            region.filter = Filter{{}, {}, region.filter.spatialFilter};
+        message.regions.swap(regions);
+    } else {
+        message.filter.spatialFilter = spatialFilter;
+        message.filter.decimation = decimation;
+    }
 
     try {
-        readMessage(fin, message, values);
+        readField(fin, message, values, stats);
+        if (withRegions)
+            message.regions.swap(regions);
     } catch (const parsing_error& e) {
-        cerr << e.what() << endl;
+        if (withRegions)
+            message.regions.swap(regions);
+        log(G2DEC_LOG_ERROR, e.status(), nullptr, e.what());
 
-        if (message.len == 0)
+        if (message.len == 0 && recovery)
+            nextMessagePos++;
+        else if (message.len == 0)
             ended = true;
         else
             nextMessagePos += message.len;
@@ -94,16 +439,173 @@ G2DEC_Status Decoder::nextMessage(G2DEC_Message& output)
         return e.status();
     }
 
+    // not selected, skipped before its data section
+    if (message.skipped) {
+        STATS(stats.messagesSkipped++;)
+        endField();
+        skipped = true;
+        return G2DEC_STATUS_OK;
+    }
+
+    // unsupported message, skipped with its next fields
+    if (message.error) {
+        log(G2DEC_LOG_WARNING, message.status, "not implemented: ", message.error);
+        nextMessagePos += message.len;
+        return message.status;
+    }
+
     convertMessage(message, output);
-    output.values = values.data();
-    output.valuesLength = values.size();
 
-    if (message.len == 0) // shouldn't occur
+    // identification section is shared by fields of message
+    identificationSection.assign(message.identificationSection);
+    productSection.swap(message.productSection);
+    output.identificationSection = identificationSection.data();
+    output.identificationSectionLength = identificationSection.size();
+    output.productSection = productSection.data();
+    output.productSectionLength = productSection.size();
+
+    if (message.pointWeights) {
+        STATS(PhaseTimer timer(&stats, G2DEC_PHASE_INTERPOLATION);)
+        applyPointWeights(*message.pointWeights, values, pointValues, &pool);
+        if (query == &regrid) {
+            output.grid = regridGrid;
+            output.values = pointValues.data();
+            output.valuesLength = pointValues.size();
+            lastValues = true;
+            lastDefinition = regridGrid;
+            lastFilter = Filter();
+        } else {
+            output.pointValues = pointValues.data();
+            output.pointValuesLength = pointValues.size();
+        }
+    } else if (withRegions) {
+        for (size_t i = 0; i < regions.size(); i++) {
+            convertRegion(regions[i], message.latitudes, regionsOutput[i]);
+            lastRegionFilters.push_back(regions[i].filter);
+        }
+        lastDefinition = message.definition;
+
+        output.regions = regionsOutput.data();
+        output.regionsLength = regionsOutput.size();
+    } else {
+        output.values = values.data();
+        output.valuesLength = values.size();
+        lastValues = true;
+        lastDefinition = message.definition;
+        lastFilter = message.filter;
+    }
+
+    endField();
+
+    STATS(stats.messages++;)
+    return G2DEC_STATUS_OK;
+}
+
+void Decoder::endField()
+{
+    if (hasMoreFields(message))
+        moreFields = true;
+    else if (message.len == 0) // shouldn't occur
         ended = true;
     else
         nextMessagePos += message.len;
+}
+
+const ValuesCoordinates *Decoder::lastCoordinates(int region)
+{
+    if (region < 0 && lastValues)
+        return &coordinates.get(lastDefinition, lastFilter);
+
+    if (region >= 0 && size_t(region) < lastRegionFilters.size())
+        return &coordinates.get(lastDefinition, lastRegionFilters[region]);
+
+    return nullptr;
+}
+
+G2DEC_Status Decoder::getLatitudes(const double *&latitudes, int& length,
+                                   int region)
+{
+    const ValuesCoordinates *values = lastCoordinates(region);
+    if (!values)
+        return G2DEC_STATUS_ERROR;
+
+    latitudes = values->lats.data();
+    length = values->lats.size();
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status Decoder::getLongitudes(const double *&longitudes, int& length,
+                                    int region)
+{
+    const ValuesCoordinates *values = lastCoordinates(region);
+    if (!values)
+        return G2DEC_STATUS_ERROR;
+
+    longitudes = values->lons.data();
+    length = values->lons.size();
+    return G2DEC_STATUS_OK;
+}
+
+void Decoder::setRecovery(bool enabled)
+{
+    recovery = enabled;
+}
+
+void Decoder::setLogLevel(G2DEC_LogLevel level)
+{
+    logLevel = level;
+}
+
+void Decoder::setLogCallback(G2DEC_LogCallback callback, void *userData)
+{
+    logCallback = callback;
+    logUserData = userData;
+}
+
+const char *Decoder::getLastError() const
+{
+    return lastError.c_str();
+}
+
+void Decoder::log(G2DEC_LogLevel level, G2DEC_Status status,
+                  const char *prefix, const char *error)
+{
+    lastError.assign(prefix ? prefix : "");
+    lastError.append(error);
+
+    if (level > logLevel)
+        return;
+
+    if (logCallback)
+        logCallback(level, status, lastError.c_str(), logUserData);
+    else
+        cerr << lastError << endl;
+}
+
+G2DEC_Status Decoder::getStats(G2DEC_Stats& output) const
+{
+#ifdef GRIB2DEC_STATS
+    output = stats;
+    output.enabled = 1;
+
+    // headers phase from sections
+    G2DEC_Counter& headers = output.phases[G2DEC_PHASE_HEADERS];
+    headers.count = stats.messages;
+    for (int id : {0, 1, 2, 3, 4, 5, 6, 8}) {
+        headers.bytes += stats.sections[id].bytes;
+        headers.seconds += stats.sections[id].seconds;
+    }
 
     return G2DEC_STATUS_OK;
+#else
+    zero(output);
+    return G2DEC_STATUS_NOT_IMPLEMENTED;
+#endif
+}
+
+void Decoder::resetStats()
+{
+    zero(stats);
 }
 
 Grib2Dec *Grib2Dec::create(istream& fin)
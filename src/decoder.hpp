@@ -2,7 +2,11 @@
 #define __DECODER_HPP
 
 #include "grib2dec/grib2dec.hpp"
+#include "coordinates.hpp"
+#include "grids.hpp"
+#include "points.hpp"
 #include "stream.hpp"
+#include "struct.hpp"
 
 #include <fstream>
 #include <vector>
@@ -15,16 +19,89 @@ public:
     Decoder(const char *filename);
 
     virtual G2DEC_Status setSpatialFilter(const G2DEC_SpatialFilter& filter);
+    virtual G2DEC_Status setDecimation(const G2DEC_Decimation& decimation);
+    virtual G2DEC_Status setRegions(const G2DEC_SpatialFilter *regions,
+                                    int nbRegions);
+    virtual G2DEC_Status setPoints(const G2DEC_Point *points, int nbPoints,
+                                   G2DEC_Interpolation interpolation);
+    virtual G2DEC_Status setRegrid(const G2DEC_Grid& target,
+                                   G2DEC_Interpolation interpolation);
+    virtual G2DEC_Status setSelections(const G2DEC_Selection *selections,
+                                       int nbSelections);
     virtual G2DEC_Status nextMessage(G2DEC_Message& message);
+    virtual G2DEC_Status getLatitudes(const double *&latitudes, int& length,
+                                      int region = -1);
+    virtual G2DEC_Status getLongitudes(const double *&longitudes, int& length,
+                                       int region = -1);
+    virtual void setRecovery(bool enabled);
+    virtual void setLogLevel(G2DEC_LogLevel level);
+    virtual void setLogCallback(G2DEC_LogCallback callback, void *userData);
+    virtual const char *getLastError() const;
+    virtual G2DEC_Status getStats(G2DEC_Stats& stats) const;
+    virtual void resetStats();
 
 private:
+    void log(G2DEC_LogLevel level, G2DEC_Status status, const char *prefix,
+             const char *error);
+    G2DEC_Status readNextMessage(G2DEC_Message& output, bool& skipped);
+    void endField();
+    const ValuesCoordinates *lastCoordinates(int region);
+
     istream& fin;
     ifstream fileStream;
     size_t nextMessagePos = 0;
     bool ended = false;
+    bool recovery = false;
     G2DEC_SpatialFilter spatialFilter;
+    G2DEC_Decimation decimation = {1, 1, 0};
 
     std::vector<double> values;
+
+    // message being read, kept between its fields
+    Message message;
+    bool moreFields = false;
+
+    // raw sections of last message
+    std::string identificationSection;
+    std::string productSection;
+
+    // regions buffers, kept between messages
+    std::vector<Region> regions;
+    std::vector<G2DEC_Region> regionsOutput;
+
+    // points query, with weights cache
+    PointsQuery points;
+    std::vector<double> pointValues;
+
+    // interpolation threads, kept between messages
+    WorkerPool pool;
+
+    // regrid, as a points query on target grid points
+    PointsQuery regrid;
+    Grid regridGrid;
+    G2DEC_Interpolation regridInterpolation = G2DEC_INTERPOLATION_NEAREST;
+
+    // messages kept by product, all if empty
+    std::vector<G2DEC_Selection> selections;
+
+    // grid definitions, with their state for current filters
+    GridCache grids;
+
+    // grid definition and filters of last message values, for coordinates
+    bool lastValues = false;
+    Grid lastDefinition;
+    Filter lastFilter;
+    std::vector<Filter> lastRegionFilters;
+    CoordinatesCache coordinates;
+
+    // errors
+    G2DEC_LogLevel logLevel = G2DEC_LOG_WARNING;
+    G2DEC_LogCallback logCallback = nullptr;
+    void *logUserData = nullptr;
+    std::string lastError;
+
+    // filled only with GRIB2DEC_STATS option
+    G2DEC_Stats stats;
 };
 
 } // grib2dec
@@ -0,0 +1,408 @@
+#include "grib2dec/grib2dec.hpp"
+#include "utils.hpp"
+#include "writer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace grib2dec {
+
+/*
+ * Complex packing encoder, templates 5.2 and 5.3 (see sections.cpp and
+ * data.cpp for decoding).
+ *
+ * Values are scaled by 10^D and rounded, then reduced by the reference
+ * value R (minimum), with E = 0. For template 5.3, spatial differences
+ * of order 1 or 2 are packed, less their minimum.
+ */
+
+namespace {
+
+const int defaultFastGroupLength = 32;
+const int defaultCompactGroupLength = 256;
+
+// values chunks merged in groups for compact splitting
+const int compactChunkLength = 8;
+
+struct Groups {
+    vector<int> refs;
+    vector<int> widths;
+    vector<int> lengths;
+
+    void add(int min, int max, int length) {
+        refs.push_back(min);
+        widths.push_back(nbBits(max - min));
+        lengths.push_back(length);
+    }
+};
+
+// groups of fixed length
+void splitFast(const vector<int>& packed, int length, Groups& groups)
+{
+    const int n = packed.size();
+
+    for (int begin = 0; begin < n; begin += length) {
+        const int end = min(n, begin + length);
+        auto range = minmax_element(packed.begin() + begin, packed.begin() + end);
+        groups.add(*range.first, *range.second, end - begin);
+    }
+}
+
+/*
+ * Values are cut in small chunks, then each chunk is merged in current
+ * group if packing them together costs less bits than a new group with
+ * its descriptors.
+ */
+void splitCompact(const vector<int>& packed, int maxLength, Groups& groups)
+{
+    const int n = packed.size();
+    const int maxValue = n ? *max_element(packed.begin(), packed.end()) : 0;
+    const int chunkLength = min(compactChunkLength, maxLength);
+
+    // reference, width and length of a group
+    const int overhead = nbBits(maxValue) + nbBits(nbBits(maxValue)) +
+                         nbBits(maxLength);
+
+    int low = 0, high = 0, length = 0;
+
+    for (int begin = 0; begin < n; begin += chunkLength) {
+        const int end = min(n, begin + chunkLength);
+        auto range = minmax_element(packed.begin() + begin, packed.begin() + end);
+        const int chunkLow = *range.first, chunkHigh = *range.second;
+
+        if (length > 0 && length + end - begin <= maxLength) {
+            const int mergedLow = min(low, chunkLow), mergedHigh = max(high, chunkHigh);
+            const int merged = (length + end - begin) * nbBits(mergedHigh - mergedLow);
+            const int separated = length * nbBits(high - low) +
+                                  (end - begin) * nbBits(chunkHigh - chunkLow) +
+                                  overhead;
+
+            if (merged <= separated) {
+                low = mergedLow;
+                high = mergedHigh;
+                length += end - begin;
+                continue;
+            }
+        }
+
+        if (length > 0)
+            groups.add(low, high, length);
+
+        low = chunkLow;
+        high = chunkHigh;
+        length = end - begin;
+    }
+
+    if (length > 0)
+        groups.add(low, high, length);
+}
+
+void earthShape(string& s, const G2DEC_Grid& grid)
+{
+    if (grid.earthRadius == 6367470.) {
+        put8(s, 0);
+        put8(s, 0);
+        put32(s, 0);
+    } else if (grid.earthRadius == 6371229.) {
+        put8(s, 6);
+        put8(s, 0);
+        put32(s, 0);
+    } else {
+        put8(s, 1);
+        put8(s, 0);
+        put32(s, lround(grid.earthRadius));
+    }
+
+    s += string(10, '\0');   // oblate spheroid
+}
+
+// templates 3.20 and 3.30, scanning directions from grid lengths signs
+void projectedGrid(string& s, const G2DEC_Grid& grid, double subdivision)
+{
+    const G2DEC_Projection& projection = grid.projection;
+
+    put32(s, grid.ni);
+    put32(s, grid.nj);
+    put32(s, magSigned32(lround(grid.lat1 * subdivision)));
+    put32(s, magSigned32(lround(grid.lon1 * subdivision)));
+    put8(s, 8);              // resolution and component flags
+    put32(s, magSigned32(lround(projection.lad * subdivision)));
+    put32(s, lround(projection.lov * subdivision));
+    put32(s, lround(fabs(projection.dx) * 1000.));
+    put32(s, lround(fabs(projection.dy) * 1000.));
+    put8(s, projection.southPole ? 0x80 : 0);
+
+    int scanningMode = 0;
+    if (projection.dx < 0)
+        scanningMode |= 0x80;
+    if (projection.dy > 0)
+        scanningMode |= 0x40;
+    put8(s, scanningMode);
+
+    if (projection.type == G2DEC_PROJECTION_LAMBERT) {
+        put32(s, magSigned32(lround(projection.latin1 * subdivision)));
+        put32(s, magSigned32(lround(projection.latin2 * subdivision)));
+        put32(s, magSigned32(lround(projection.latSouthPole * subdivision)));
+        put32(s, lround(projection.lonSouthPole * subdivision));
+    }
+}
+
+void gridSection(string& out, const G2DEC_Grid& grid)
+{
+    const double subdivision = 1e6;
+    const bool projected = grid.projection.type != G2DEC_PROJECTION_NONE;
+    string s;
+
+    put8(s, 0);              // source of grid definition
+    put32(s, grid.ni * grid.nj);
+    put8(s, 0);              // no optional list
+    put8(s, 0);
+
+    // template 3.0, 3.20, 3.30 or 3.40
+    if (projected)
+        put16(s, grid.projection.type);
+    else
+        put16(s, grid.gaussianN > 0 ? 40 : 0);
+
+    earthShape(s, grid);
+
+    if (projected) {
+        projectedGrid(s, grid, subdivision);
+        return section(out, 3, s);
+    }
+
+    put32(s, grid.ni);
+    put32(s, grid.nj);
+    put32(s, 0);             // basic angle
+    put32(s, 0xffffffff);    // subdivisions: micro degrees
+    put32(s, magSigned32(lround(grid.lat1 * subdivision)));
+    put32(s, magSigned32(lround(grid.lon1 * subdivision)));
+    put8(s, 48);             // resolution and component flags
+    put32(s, magSigned32(lround(grid.lat2 * subdivision)));
+    put32(s, magSigned32(lround(grid.lon2 * subdivision)));
+    put32(s, lround(fabs(grid.lonInc) * subdivision));
+    if (grid.gaussianN > 0)
+        put32(s, grid.gaussianN);
+    else
+        put32(s, lround(fabs(grid.latInc) * subdivision));
+
+    // scanning mode, raster from lat1 / lon1
+    int scanningMode = 0;
+    if (grid.lonInc < 0)
+        scanningMode |= 0x80;
+    if (grid.latInc > 0)
+        scanningMode |= 0x40;
+    put8(s, scanningMode);
+
+    section(out, 3, s);
+}
+
+/*
+ * Data representation and data sections.
+ * Throws encoding_error if values cannot be packed.
+ */
+void packValues(const double *values, int nbValues,
+                const G2DEC_EncodeOptions& options, string& out)
+{
+    const int order = options.tpl == 3 ? options.spatialOrder : 0;
+    const double dscale = pow(10., options.decimalScale);
+
+    // scaled values and reference value
+    vector<int64_t> scaled(nbValues);
+    for (int k = 0; k < nbValues; k++) {
+        if (!isfinite(values[k]))
+            throw encoding_error("cannot encode missing values");
+        scaled[k] = llround(values[k] * dscale);
+    }
+
+    const int64_t minValue = nbValues ? *min_element(scaled.begin(), scaled.end()) : 0;
+    const int64_t maxValue = nbValues ? *max_element(scaled.begin(), scaled.end()) : 0;
+
+    // R as float must not exceed minimum
+    float R = minValue;
+    if (double(R) > double(minValue))
+        R = nextafterf(R, -INFINITY);
+    const int64_t ref = llround(R);
+
+    if (maxValue - ref >= (int64_t(1) << 30))
+        throw encoding_error("values range too large for decimal scale");
+
+    // values to pack, spatial differences for template 5.3
+    vector<int> packed(nbValues, 0);
+    for (int k = 0; k < nbValues; k++)
+        packed[k] = scaled[k] - ref;
+
+    int first[2] = {0, 0};
+    int hmin = 0;
+
+    if (order > 0 && nbValues > order) {
+        vector<int> x = packed;
+
+        for (int k = 0; k < order; k++) {
+            first[k] = x[k];
+            packed[k] = 0;
+        }
+
+        for (int k = order; k < nbValues; k++) {
+            packed[k] = order == 1 ? x[k] - x[k - 1]
+                                   : x[k] - 2 * x[k - 1] + x[k - 2];
+        }
+
+        hmin = *min_element(packed.begin() + order, packed.end());
+        for (int k = order; k < nbValues; k++)
+            packed[k] -= hmin;
+    } else if (order > 0) {
+        throw encoding_error("not enough values for spatial differencing");
+    }
+
+    // groups
+    Groups groups;
+
+    if (options.groupSplitting == G2DEC_GROUP_SPLITTING_COMPACT) {
+        splitCompact(packed, options.groupLength > 0 ? options.groupLength
+                                                     : defaultCompactGroupLength,
+                     groups);
+    } else {
+        splitFast(packed, options.groupLength > 0 ? options.groupLength
+                                                  : defaultFastGroupLength,
+                  groups);
+    }
+
+    const int ng = groups.refs.size();
+    const int refBits = ng ? nbBits(*max_element(groups.refs.begin(), groups.refs.end())) : 0;
+    const int widthBits = ng ? nbBits(*max_element(groups.widths.begin(), groups.widths.end())) : 0;
+    const int lengthRef = ng ? *min_element(groups.lengths.begin(), groups.lengths.end()) : 0;
+    const int lengthBits = ng ? nbBits(*max_element(groups.lengths.begin(), groups.lengths.end()) - lengthRef) : 0;
+
+    // extra descriptors of spatial differencing, 2 or 4 bytes
+    int extraBytes = 2;
+    for (int v : {first[0], first[1], hmin}) {
+        if (abs(v) >= (1 << 15))
+            extraBytes = 4;
+    }
+
+    // data representation section
+    string s;
+    put32(s, nbValues);
+    put16(s, options.tpl);
+    uint32_t bitsR;
+    memcpy(&bitsR, &R, sizeof(bitsR));
+    put32(s, bitsR);
+    put16(s, 0);             // E
+    put16(s, magSigned16(options.decimalScale));
+    put8(s, refBits);
+    put8(s, 0);              // floating point values
+    put8(s, 1);              // general group splitting
+    put8(s, 0);              // no missing values
+    put32(s, 0);
+    put32(s, 0);
+    put32(s, ng);
+    put8(s, 0);              // group width reference
+    put8(s, widthBits);
+    put32(s, lengthRef);
+    put8(s, 1);              // length increment
+    put32(s, ng ? groups.lengths.back() : 0);
+    put8(s, lengthBits);
+
+    if (order > 0) {
+        put8(s, order);
+        put8(s, extraBytes);
+    }
+
+    section(out, 5, s);
+
+    // no bitmap
+    section(out, 6, string(1, char(255)));
+
+    // data section
+    string d;
+
+    if (order > 0) {
+        vector<int> extras(first, first + order);
+        extras.push_back(hmin);
+
+        for (int v : extras) {
+            if (extraBytes == 2)
+                put16(d, magSigned16(v));
+            else
+                put32(d, magSigned32(v));
+        }
+    }
+
+    BitWriter writer(d);
+
+    for (int v : groups.refs)
+        writer.bits(v, refBits);
+    writer.end();
+
+    for (int v : groups.widths)
+        writer.bits(v, widthBits);
+    writer.end();
+
+    for (int v : groups.lengths)
+        writer.bits(v - lengthRef, lengthBits);
+    writer.end();
+
+    for (int g = 0, k = 0; g < ng; g++) {
+        const int groupRef = groups.refs[g], width = groups.widths[g];
+        for (int l = 0; l < groups.lengths[g]; l++, k++)
+            writer.bits(packed[k] - groupRef, width);
+    }
+    writer.end();
+
+    section(out, 7, d);
+}
+
+} // local namespace
+
+G2DEC_Status encode(const G2DEC_Message& message,
+                    const G2DEC_EncodeOptions& options, ostream& out)
+{
+    const G2DEC_Grid& grid = message.grid;
+
+    if (options.tpl != 2 && options.tpl != 3)
+        return G2DEC_STATUS_NOT_IMPLEMENTED;
+
+    if (options.tpl == 3 && options.spatialOrder != 1 && options.spatialOrder != 2)
+        return G2DEC_STATUS_ERROR;
+
+    if (!message.values || message.valuesLength != grid.ni * grid.nj ||
+        message.valuesLength == 0)
+        return G2DEC_STATUS_ERROR;
+
+    if (!message.identificationSection || message.identificationSectionLength < 5 ||
+        !message.productSection || message.productSectionLength < 5)
+        return G2DEC_STATUS_ERROR;
+
+    string body;
+    body.append(message.identificationSection, message.identificationSectionLength);
+    gridSection(body, grid);
+    body.append(message.productSection, message.productSectionLength);
+
+    try {
+        packValues(message.values, message.valuesLength, options, body);
+    } catch (const encoding_error& e) {
+        cerr << e.what() << endl;
+        return e.status();
+    }
+
+    body += "7777";
+
+    // indicator section
+    string header = "GRIB";
+    put16(header, 0);
+    put8(header, message.discipline >= 0 ? message.discipline : 255);
+    put8(header, 2);
+    put64(header, body.size() + 16);
+
+    out << header << body;
+    return out ? G2DEC_STATUS_OK : G2DEC_STATUS_ERROR;
+}
+
+} // grib2dec
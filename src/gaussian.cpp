@@ -0,0 +1,105 @@
+#include "gaussian.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace grib2dec {
+namespace {
+
+// latitudes are computed in O(N^2), N is 1280 for 9 km grids
+const int maxN = 8000;
+
+/*
+ * Roots of Legendre polynomial of degree 2N by Newton iterations, from
+ * an asymptotic first guess. Southern latitudes are symmetric.
+ */
+void computeLatitudes(int N, vector<double>& latitudes)
+{
+    const int n = 2 * N;
+    latitudes.resize(n);
+
+    for (int i = 0; i < N; i++) {
+        double z = cos(M_PI * (i + 0.75) / (n + 0.5));
+
+        for (int iteration = 0; iteration < 100; iteration++) {
+            // P_n(z) and P_n-1(z) by recurrence
+            double p = 1., previous = 0.;
+            for (int k = 1; k <= n; k++) {
+                double p2 = previous;
+                previous = p;
+                p = ((2 * k - 1) * z * previous - (k - 1) * p2) / k;
+            }
+
+            double derivative = n * (z * p - previous) / (z * z - 1.);
+            double delta = p / derivative;
+            z -= delta;
+
+            if (fabs(delta) < 1e-15)
+                break;
+        }
+
+        latitudes[i] = asin(z) * 180. / M_PI;
+        latitudes[n - 1 - i] = -latitudes[i];
+    }
+}
+
+// index of latitude in table, or -1
+int latitudeIndex(const vector<double>& table, double lat)
+{
+    // table is from north to south
+    auto it = lower_bound(table.begin(), table.end(), lat, greater<double>());
+
+    int j = it - table.begin();
+    if (j > 0 && (j == int(table.size()) || fabs(table[j - 1] - lat) < fabs(table[j] - lat)))
+        j--;
+
+    // latitudes are rounded in grid definition
+    const double tolerance = 0.25 * 180. / table.size();
+    return fabs(table[j] - lat) < tolerance ? j : -1;
+}
+
+} // local namespace
+
+const vector<double>& gaussianLatitudes(int N)
+{
+    static mutex cacheMutex;
+    static map<int, unique_ptr<vector<double>>> cache;
+
+    lock_guard<mutex> lock(cacheMutex);
+
+    auto& latitudes = cache[N];
+    if (!latitudes) {
+        latitudes.reset(new vector<double>);
+        computeLatitudes(N, *latitudes);
+    }
+
+    return *latitudes;
+}
+
+bool gaussianRows(const Grid& grid, vector<double>& latitudes)
+{
+    if (grid.gaussianN <= 0 || grid.gaussianN > maxN || grid.nj <= 0)
+        return false;
+
+    const vector<double>& table = gaussianLatitudes(grid.gaussianN);
+
+    const int j1 = latitudeIndex(table, grid.lat1);
+    const int j2 = latitudeIndex(table, grid.lat2);
+
+    if (j1 < 0 || j2 < 0 || abs(j2 - j1) + 1 != grid.nj)
+        return false;
+
+    latitudes.resize(grid.nj);
+    const int step = j2 >= j1 ? 1 : -1;
+    for (int j = 0; j < grid.nj; j++)
+        latitudes[j] = table[j1 + j * step];
+
+    return true;
+}
+
+} // grib2dec
@@ -0,0 +1,28 @@
+#ifndef __GAUSSIAN_HPP
+#define __GAUSSIAN_HPP
+
+#include "struct.hpp"
+
+#include <vector>
+
+namespace grib2dec {
+
+/**
+ * Latitudes of a gaussian grid with N parallels between a pole and the
+ * equator : 2N latitudes in degree, from north to south.
+ *
+ * Latitudes are roots of Legendre polynomial of degree 2N, computed once
+ * by N and shared by all decoders.
+ */
+const std::vector<double>& gaussianLatitudes(int N);
+
+/**
+ * Rows latitudes of a gaussian grid, from lat1 to lat2.
+ * Returns false if N is too large or if grid limits are not latitudes of
+ * the gaussian grid.
+ */
+bool gaussianRows(const Grid& grid, std::vector<double>& latitudes);
+
+} // grib2dec
+
+#endif
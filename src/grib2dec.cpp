@@ -1,6 +1,8 @@
 #include "grib2dec/grib2dec.h"
 #include "decoder.hpp"
 
+#include <sstream>
+
 using namespace grib2dec;
 
 
@@ -19,6 +21,59 @@ G2DEC_Status G2DEC_setSpatialFilter(G2DEC_Handle handle,
     return reinterpret_cast<Grib2Dec*>(handle)->setSpatialFilter(*filter);
 }
 
+G2DEC_Status G2DEC_setDecimation(G2DEC_Handle handle,
+                                 const G2DEC_Decimation *decimation)
+{
+    if (!handle || !decimation)
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->setDecimation(*decimation);
+}
+
+G2DEC_Status G2DEC_setRegions(G2DEC_Handle handle,
+                              const G2DEC_SpatialFilter *regions,
+                              int nbRegions)
+{
+    if (!handle || (!regions && nbRegions))
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->setRegions(regions, nbRegions);
+}
+
+G2DEC_Status G2DEC_setPoints(G2DEC_Handle handle,
+                             const G2DEC_Point *points,
+                             int nbPoints,
+                             G2DEC_Interpolation interpolation)
+{
+    if (!handle || (!points && nbPoints))
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->setPoints(points, nbPoints,
+                                                          interpolation);
+}
+
+G2DEC_Status G2DEC_setRegrid(G2DEC_Handle handle,
+                             const G2DEC_Grid *target,
+                             G2DEC_Interpolation interpolation)
+{
+    if (!handle || !target)
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->setRegrid(*target,
+                                                          interpolation);
+}
+
+G2DEC_Status G2DEC_setSelections(G2DEC_Handle handle,
+                                 const G2DEC_Selection *selections,
+                                 int nbSelections)
+{
+    if (!handle || (!selections && nbSelections))
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->setSelections(selections,
+                                                              nbSelections);
+}
+
 G2DEC_Status G2DEC_nextMessage(G2DEC_Handle handle, G2DEC_Message *message)
 {
     if (!handle || !message)
@@ -27,6 +82,193 @@ G2DEC_Status G2DEC_nextMessage(G2DEC_Handle handle, G2DEC_Message *message)
     return reinterpret_cast<Grib2Dec*>(handle)->nextMessage(*message);
 }
 
+G2DEC_Status G2DEC_getLatitudes(G2DEC_Handle handle, int region,
+                                const double **latitudes, int *length)
+{
+    if (!handle || !latitudes || !length)
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->getLatitudes(*latitudes, *length, region);
+}
+
+G2DEC_Status G2DEC_getLongitudes(G2DEC_Handle handle, int region,
+                                 const double **longitudes, int *length)
+{
+    if (!handle || !longitudes || !length)
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->getLongitudes(*longitudes, *length, region);
+}
+
+void G2DEC_setRecovery(G2DEC_Handle handle, int enabled)
+{
+    if (handle)
+        reinterpret_cast<Grib2Dec*>(handle)->setRecovery(enabled != 0);
+}
+
+void G2DEC_setLogLevel(G2DEC_Handle handle, G2DEC_LogLevel level)
+{
+    if (handle)
+        reinterpret_cast<Grib2Dec*>(handle)->setLogLevel(level);
+}
+
+void G2DEC_setLogCallback(G2DEC_Handle handle, G2DEC_LogCallback callback,
+                          void *userData)
+{
+    if (handle)
+        reinterpret_cast<Grib2Dec*>(handle)->setLogCallback(callback, userData);
+}
+
+const char *G2DEC_getLastError(G2DEC_Handle handle)
+{
+    if (!handle)
+        return "";
+
+    return reinterpret_cast<Grib2Dec*>(handle)->getLastError();
+}
+
+G2DEC_Status G2DEC_getStats(G2DEC_Handle handle, G2DEC_Stats *stats)
+{
+    if (!handle || !stats)
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<Grib2Dec*>(handle)->getStats(*stats);
+}
+
+void G2DEC_resetStats(G2DEC_Handle handle)
+{
+    if (handle)
+        reinterpret_cast<Grib2Dec*>(handle)->resetStats();
+}
+
+void G2DEC_startTrace()
+{
+    startTrace();
+}
+
+G2DEC_Status G2DEC_stopTrace(const char *filename)
+{
+    if (!filename)
+        return G2DEC_STATUS_ERROR;
+
+    return stopTrace(filename);
+}
+
+G2DEC_Status G2DEC_encode(const G2DEC_Message *message,
+                          const G2DEC_EncodeOptions *options,
+                          FILE *file)
+{
+    if (!message || !options || !file)
+        return G2DEC_STATUS_ERROR;
+
+    ostringstream out;
+    G2DEC_Status status = encode(*message, *options, out);
+    if (status != G2DEC_STATUS_OK)
+        return status;
+
+    const string data = out.str();
+    if (fwrite(data.data(), 1, data.size(), file) != data.size())
+        return G2DEC_STATUS_ERROR;
+
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status G2DEC_buildCube(const char *const *inputs, int nbInputs,
+                             const G2DEC_Selection *parameters,
+                             int nbParameters,
+                             const G2DEC_CubeOptions *options,
+                             const char *output, char *error, int errorSize)
+{
+    if (!inputs || !parameters || !options || !output)
+        return G2DEC_STATUS_ERROR;
+
+    string errorText;
+    const G2DEC_Status status = buildCube(inputs, nbInputs, parameters,
+                                          nbParameters, *options, output,
+                                          &errorText);
+
+    if (status != G2DEC_STATUS_OK && error && errorSize > 0)
+        snprintf(error, errorSize, "%s", errorText.c_str());
+
+    return status;
+}
+
+G2DEC_Status G2DEC_readCubeHeader(const char *filename,
+                                  G2DEC_CubeHeader *header)
+{
+    if (!filename || !header)
+        return G2DEC_STATUS_ERROR;
+
+    return readCubeHeader(filename, *header);
+}
+
+G2DEC_Status G2DEC_readCubePoint(const char *filename, int point,
+                                 float *values)
+{
+    if (!filename || !values)
+        return G2DEC_STATUS_ERROR;
+
+    return readCubePoint(filename, point, values);
+}
+
+G2DEC_WindHandle G2DEC_createWindQuery()
+{
+    return WindQuery::create();
+}
+
+void G2DEC_windSetLevel(G2DEC_WindHandle handle, int levelType, double level)
+{
+    if (handle)
+        reinterpret_cast<WindQuery*>(handle)->setLevel(levelType, level);
+}
+
+void G2DEC_windSetTimeRange(G2DEC_WindHandle handle, double begin, double end)
+{
+    if (handle)
+        reinterpret_cast<WindQuery*>(handle)->setTimeRange(begin, end);
+}
+
+G2DEC_Status G2DEC_windLoad(G2DEC_WindHandle handle, const char *filename)
+{
+    if (!handle || !filename)
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<WindQuery*>(handle)->load(filename);
+}
+
+const char *G2DEC_windGetLastError(G2DEC_WindHandle handle)
+{
+    if (!handle)
+        return "";
+
+    return reinterpret_cast<WindQuery*>(handle)->getLastError();
+}
+
+G2DEC_Status G2DEC_windGetTimes(G2DEC_WindHandle handle, const double **times,
+                                int *length)
+{
+    if (!handle || !times || !length)
+        return G2DEC_STATUS_ERROR;
+
+    reinterpret_cast<WindQuery*>(handle)->getTimes(*times, *length);
+    return G2DEC_STATUS_OK;
+}
+
+G2DEC_Status G2DEC_windQuery(G2DEC_WindHandle handle,
+                             const G2DEC_WindPoint *points, int nbPoints,
+                             double *u, double *v)
+{
+    if (!handle)
+        return G2DEC_STATUS_ERROR;
+
+    return reinterpret_cast<WindQuery*>(handle)->query(points, nbPoints, u, v);
+}
+
+void G2DEC_deleteWindQuery(G2DEC_WindHandle handle)
+{
+    delete reinterpret_cast<WindQuery*>(handle);
+}
+
 void G2DEC_Close(G2DEC_Handle handle)
 {
     Grib2Dec *decoder = reinterpret_cast<Grib2Dec*>(handle);
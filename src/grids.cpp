@@ -0,0 +1,60 @@
+#include "grids.hpp"
+
+using namespace std;
+
+namespace grib2dec {
+
+void GridEntry::store(const Message& message)
+{
+    parsed = true;
+    grid = message.grid;
+    definition = message.definition;
+    latitudes = message.latitudes;
+    columnMajor = message.columnMajor;
+    boustrophedon = message.boustrophedon;
+    filter = message.filter;
+    pointWeights = message.pointWeights;
+    status = message.status;
+    error = message.error;
+
+    regions.clear();
+    for (const Region& region : message.regions)
+        regions.emplace_back(region.grid, region.filter);
+}
+
+void GridEntry::apply(Message& message) const
+{
+    message.grid = grid;
+    message.definition = definition;
+    message.latitudes = latitudes;
+    message.columnMajor = columnMajor;
+    message.boustrophedon = boustrophedon;
+    message.filter = filter;
+    message.pointWeights = pointWeights;
+    message.status = status;
+    message.error = error;
+
+    for (size_t k = 0; k < regions.size() && k < message.regions.size(); k++) {
+        message.regions[k].grid = regions[k].first;
+        message.regions[k].filter = regions[k].second;
+    }
+}
+
+GridEntry& GridCache::find(const string& raw)
+{
+    auto& entry = entries[raw];
+    if (!entry) {
+        entry.reset(new GridEntry);
+        entry->id = entries.size() - 1;
+    }
+
+    return *entry;
+}
+
+void GridCache::invalidate()
+{
+    for (auto& entry : entries)
+        entry.second->parsed = false;
+}
+
+} // grib2dec
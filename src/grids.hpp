@@ -0,0 +1,58 @@
+#ifndef __GRIDS_HPP
+#define __GRIDS_HPP
+
+#include "struct.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace grib2dec {
+
+/*
+ * Grid definition met by a decoder, with the state set by its grid
+ * section: grid, filters and points weights.
+ */
+struct GridEntry {
+    int id;
+
+    // state after grid section, valid while decoder filters are unchanged
+    bool parsed = false;
+    Grid grid;
+    Grid definition;
+    std::vector<double> latitudes;
+    bool columnMajor;
+    bool boustrophedon;
+    Filter filter;
+    std::vector<std::pair<Grid, Filter>> regions;
+    const PointWeights *pointWeights;
+    G2DEC_Status status;
+    const char *error;
+
+    void store(const Message& message);
+    void apply(Message& message) const;
+};
+
+/*
+ * Grid definitions by raw grid section: a grid section is parsed once,
+ * next messages with the same section reuse its state.
+ */
+class GridCache {
+public:
+    // entry of a raw grid section, created with a new id if not found
+    GridEntry& find(const std::string& section);
+
+    // decoder filters changed: parsed states are dropped, ids are kept
+    void invalidate();
+
+    std::string section;  // raw section buffer
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<GridEntry>> entries;
+};
+
+} // grib2dec
+
+#endif
@@ -0,0 +1,331 @@
+#include "points.hpp"
+#include "gaussian.hpp"
+#include "projection.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace grib2dec {
+namespace {
+
+const double epsilon = 1e-6;
+
+// minimum number of points by thread when applying weights
+const int minPointsByThread = 1 << 16;
+
+bool isGlobal(const Grid& grid)
+{
+    return fabs(grid.ni * grid.lonInc) >= 360. - epsilon;
+}
+
+// fractional column of a longitude, -1 if outside grid
+double columnPosition(const Grid& grid, double lon, bool global)
+{
+    double d = fmod(lon - grid.lon1, 360.);
+    if (grid.lonInc > 0 && d < 0)
+        d += 360.;
+    else if (grid.lonInc < 0 && d > 0)
+        d -= 360.;
+
+    double fi = d / grid.lonInc;
+
+    // rounding error just before first column
+    if (fi > grid.ni - 1 + epsilon && 360. / fabs(grid.lonInc) - fi < epsilon)
+        fi = 0.;
+
+    if (fi > grid.ni - 1 + epsilon && !global)
+        return -1.;
+
+    return fi;
+}
+
+// fractional row of a latitude, -1 if outside grid
+double rowPosition(const Grid& grid, const vector<double>& latitudes, double lat)
+{
+    double fj;
+
+    if (!latitudes.empty()) {
+        // gaussian grid, latitudes are monotonic
+        const bool descending = grid.latInc < 0;
+        auto it = partition_point(latitudes.begin(), latitudes.end(), [&](double l) {
+            return descending ? l > lat : l < lat;
+        });
+
+        int j = it - latitudes.begin();
+        if (j == 0 || j == grid.nj)
+            fj = fabs(lat - latitudes[j ? j - 1 : 0]) < epsilon ? max(0, j - 1) : -1.;
+        else
+            fj = j - 1 + (lat - latitudes[j - 1]) / (latitudes[j] - latitudes[j - 1]);
+
+        return fj;
+    }
+
+    fj = (lat - grid.lat1) / grid.latInc;
+
+    if (fj < -epsilon || fj > grid.nj - 1 + epsilon)
+        return -1.;
+
+    return max(0., min<double>(fj, grid.nj - 1));
+}
+
+// fractional position in a projected grid of n points, -1 if outside
+double projectedPosition(double f, int n)
+{
+    if (!(f > -epsilon && f < n - 1 + epsilon))
+        return -1.;
+
+    return max(0., min<double>(f, n - 1));
+}
+
+void computeWeights(const Grid& grid, const vector<G2DEC_Point>& points,
+                    G2DEC_Interpolation interpolation, PointWeights& weights)
+{
+    const int nbPoints = points.size();
+    const bool isProjected = projected(grid);
+    const bool global = !isProjected && isGlobal(grid);
+
+    vector<double> latitudes;
+    gaussianRows(grid, latitudes);
+
+    // projected grids: positions of all points
+    vector<double> projectedI, projectedJ;
+    if (isProjected)
+        gridPositions(grid, points, projectedI, projectedJ);
+
+    weights.grid = grid;
+    weights.nbWeights = interpolation == G2DEC_INTERPOLATION_BILINEAR ? 4 : 1;
+
+    // grid row and column of each weight, for now
+    vector<int> js[4];
+
+    for (int k = 0; k < weights.nbWeights; k++) {
+        weights.index[k].assign(nbPoints, -1);
+        weights.weight[k].assign(nbPoints, 0.);
+        js[k].assign(nbPoints, 0);
+    }
+
+    weights.rowSlots.assign(grid.nj, -1);
+
+    for (int p = 0; p < nbPoints; p++) {
+        double fi, fj;
+        if (isProjected) {
+            fi = projectedPosition(projectedI[p], grid.ni);
+            fj = projectedPosition(projectedJ[p], grid.nj);
+        } else {
+            fi = grid.ni > 0 ? columnPosition(grid, points[p].lon, global) : -1.;
+            fj = grid.nj > 0 ? rowPosition(grid, latitudes, points[p].lat) : -1.;
+        }
+
+        if (fi < 0 || fj < 0)
+            continue;
+
+        if (weights.nbWeights == 1) {
+            int i = lround(fi);
+            if (i >= grid.ni)
+                i = global ? 0 : grid.ni - 1;
+
+            js[0][p] = lround(fj);
+            weights.index[0][p] = i;
+            weights.weight[0][p] = 1.;
+        } else {
+            int i0 = min<int>(floor(fi), grid.ni - 1);
+            int i1 = i0 + 1;
+            if (i1 >= grid.ni)
+                i1 = global ? 0 : grid.ni - 1;
+
+            int j0 = min<int>(floor(fj), grid.nj - 1);
+            int j1 = min(j0 + 1, grid.nj - 1);
+
+            double di = fi - i0, dj = fj - j0;
+
+            js[0][p] = j0;
+            js[1][p] = j0;
+            js[2][p] = j1;
+            js[3][p] = j1;
+            weights.index[0][p] = i0;
+            weights.index[1][p] = i1;
+            weights.index[2][p] = i0;
+            weights.index[3][p] = i1;
+            weights.weight[0][p] = (1. - di) * (1. - dj);
+            weights.weight[1][p] = di * (1. - dj);
+            weights.weight[2][p] = (1. - di) * dj;
+            weights.weight[3][p] = di * dj;
+        }
+
+        for (int k = 0; k < weights.nbWeights; k++)
+            weights.rowSlots[js[k][p]] = 0;
+    }
+
+    // needed rows
+    weights.rows.clear();
+    for (int j = 0; j < grid.nj; j++) {
+        if (weights.rowSlots[j] >= 0) {
+            weights.rowSlots[j] = weights.rows.size();
+            weights.rows.push_back(j);
+        }
+    }
+
+    // index in rows buffer
+    for (int k = 0; k < weights.nbWeights; k++) {
+        for (int p = 0; p < nbPoints; p++) {
+            int& i = weights.index[k][p];
+            if (i >= 0)
+                i += weights.rowSlots[js[k][p]] * grid.ni;
+        }
+    }
+}
+
+void applyWeights(const PointWeights& weights, const double *rows,
+                  double *values, int begin, int end)
+{
+    TraceScope trace("interpolation");
+    const int *index0 = weights.index[0].data();
+
+    if (weights.nbWeights == 1) {
+        for (int p = begin; p < end; p++)
+            values[p] = index0[p] < 0 ? NAN : rows[index0[p]];
+        return;
+    }
+
+    const int *index1 = weights.index[1].data();
+    const int *index2 = weights.index[2].data();
+    const int *index3 = weights.index[3].data();
+    const double *weight0 = weights.weight[0].data();
+    const double *weight1 = weights.weight[1].data();
+    const double *weight2 = weights.weight[2].data();
+    const double *weight3 = weights.weight[3].data();
+
+    for (int p = begin; p < end; p++) {
+        if (index0[p] < 0) {
+            values[p] = NAN;
+            continue;
+        }
+
+        values[p] = weight0[p] * rows[index0[p]] + weight1[p] * rows[index1[p]] +
+                    weight2[p] * rows[index2[p]] + weight3[p] * rows[index3[p]];
+    }
+}
+
+} // local namespace
+
+bool sameGrid(const Grid& a, const Grid& b)
+{
+    return a.earthRadius == b.earthRadius && a.ni == b.ni && a.nj == b.nj &&
+           a.lon1 == b.lon1 && a.lon2 == b.lon2 &&
+           a.lat1 == b.lat1 && a.lat2 == b.lat2 &&
+           a.lonInc == b.lonInc && a.latInc == b.latInc &&
+           a.gaussianN == b.gaussianN &&
+           sameProjection(a.projection, b.projection);
+}
+
+void PointsQuery::set(const G2DEC_Point *newPoints, int nbPoints,
+                      G2DEC_Interpolation newInterpolation)
+{
+    points.assign(newPoints, newPoints + nbPoints);
+    interpolation = newInterpolation;
+    cache.clear();
+}
+
+const PointWeights& PointsQuery::weights(const Grid& grid)
+{
+    for (const auto& weights : cache) {
+        if (sameGrid(weights->grid, grid))
+            return *weights;
+    }
+
+    cache.emplace_back(new PointWeights);
+    computeWeights(grid, points, interpolation, *cache.back());
+    return *cache.back();
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& t : threads)
+        t.join();
+}
+
+int WorkerPool::size() const
+{
+    return max(1u, thread::hardware_concurrency());
+}
+
+void WorkerPool::run(int chunks, const function<void(int)>& f)
+{
+    unique_lock<std::mutex> lock(mutex);
+
+    if (threads.empty()) {
+        for (int t = 1; t < size(); t++)
+            threads.emplace_back(&WorkerPool::work, this);
+    }
+
+    task = &f;
+    nbChunks = chunks;
+    nextChunk = 0;
+    remaining = chunks;
+    wake.notify_all();
+
+    while (nextChunk < nbChunks) {
+        const int chunk = nextChunk++;
+        lock.unlock();
+        f(chunk);
+        lock.lock();
+        remaining--;
+    }
+
+    done.wait(lock, [this]() { return remaining == 0; });
+    task = nullptr;
+}
+
+void WorkerPool::work()
+{
+    unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wake.wait(lock, [this]() {
+            return stopping || (task && nextChunk < nbChunks);
+        });
+        if (stopping)
+            return;
+
+        const int chunk = nextChunk++;
+        const function<void(int)> *f = task;
+        lock.unlock();
+        (*f)(chunk);
+        lock.lock();
+
+        if (--remaining == 0)
+            done.notify_all();
+    }
+}
+
+void applyPointWeights(const PointWeights& weights,
+                       const vector<double>& rowsValues,
+                       vector<double>& values, WorkerPool *pool)
+{
+    const int nbPoints = weights.index[0].size();
+    values.resize(nbPoints);
+
+    const int nbThreads = pool ? min(pool->size(), nbPoints / minPointsByThread) : 1;
+
+    if (nbThreads <= 1)
+        return applyWeights(weights, rowsValues.data(), values.data(), 0, nbPoints);
+
+    // points chunks, shared by threads of pool
+    const int chunk = (nbPoints + nbThreads - 1) / nbThreads;
+
+    pool->run(nbThreads, [&](int t) {
+        applyWeights(weights, rowsValues.data(), values.data(),
+                     min(nbPoints, t * chunk), min(nbPoints, (t + 1) * chunk));
+    });
+}
+
+} // grib2dec
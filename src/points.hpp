@@ -0,0 +1,90 @@
+#ifndef __POINTS_HPP
+#define __POINTS_HPP
+
+#include "struct.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace grib2dec {
+
+/*
+ * Interpolation weights of points for a grid definition.
+ *
+ * Values needed by points are read from a rows buffer, containing
+ * only grid rows in rows list, in order.
+ */
+struct PointWeights {
+    Grid grid;
+    int nbWeights = 0;  // 1 for nearest, 4 for bilinear
+
+    std::vector<int> rows;      // grid rows needed, sorted
+    std::vector<int> rowSlots;  // row position in rows buffer, or -1
+
+    // index in rows buffer and weight, for each point
+    std::vector<int> index[4];
+    std::vector<double> weight[4];
+};
+
+class PointsQuery {
+public:
+    void set(const G2DEC_Point *points, int nbPoints,
+             G2DEC_Interpolation interpolation);
+
+    bool empty() const {
+        return points.empty();
+    }
+
+    // weights for a grid, computed once by grid definition
+    const PointWeights& weights(const Grid& grid);
+
+private:
+    std::vector<G2DEC_Point> points;
+    G2DEC_Interpolation interpolation = G2DEC_INTERPOLATION_NEAREST;
+    std::vector<std::unique_ptr<PointWeights>> cache;
+};
+
+/*
+ * Threads of a decoder for points interpolation, started on first use and
+ * kept until decoder is deleted.
+ */
+class WorkerPool {
+public:
+    ~WorkerPool();
+
+    // threads available, calling thread included
+    int size() const;
+
+    // calls task for each chunk in [0, nbChunks[, calling thread included
+    void run(int nbChunks, const std::function<void(int)>& task);
+
+private:
+    void work();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int)> *task = nullptr;
+    int nbChunks = 0;
+    int nextChunk = 0;
+    int remaining = 0;
+    bool stopping = false;
+};
+
+bool sameGrid(const Grid& a, const Grid& b);
+
+// points are split between threads of pool, if any
+void applyPointWeights(const PointWeights& weights,
+                       const std::vector<double>& rowsValues,
+                       std::vector<double>& values,
+                       WorkerPool *pool = nullptr);
+
+} // grib2dec
+
+#endif
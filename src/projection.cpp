@@ -0,0 +1,191 @@
+#include "projection.hpp"
+#include "trace.hpp"
+
+#include <cmath>
+#include <mutex>
+
+using namespace std;
+
+namespace grib2dec {
+namespace {
+
+const double toRadian = M_PI / 180.;
+const double toDegree = 180. / M_PI;
+
+// number of coordinates tables kept
+const size_t cacheSize = 4;
+
+/*
+ * Lambert conformal conic projection on a sphere, polar stereographic
+ * being the cone of constant n = 1 (-1 for south pole):
+ *   rho = RF / tan(pi/4 + lat/2)^n, theta = n (lon - lov)
+ *   x = rho sin(theta), y = -rho cos(theta)
+ *
+ * Plane coordinates are in meters, grid point (i, j) is at
+ * (x1 + i dx, y1 + j dy).
+ */
+class Projector {
+public:
+    explicit Projector(const Grid& grid) {
+        const G2DEC_Projection& p = grid.projection;
+        const double R = grid.earthRadius;
+        double scale = 1.;
+        lov = p.lov;
+
+        if (p.type == G2DEC_PROJECTION_POLAR_STEREOGRAPHIC) {
+            // true scale at lad
+            n = p.southPole ? -1. : 1.;
+            RF = n * R * (1. + n * sin(p.lad * toRadian));
+        } else {
+            const double phi1 = p.latin1 * toRadian, phi2 = p.latin2 * toRadian;
+            if (fabs(phi1 - phi2) < 1e-10)
+                n = sin(phi1);
+            else
+                n = log(cos(phi1) / cos(phi2)) /
+                    log(tan(M_PI / 4 + phi2 / 2) / tan(M_PI / 4 + phi1 / 2));
+            RF = R * cos(phi1) * pow(tan(M_PI / 4 + phi1 / 2), n) / n;
+
+            // scale factor at lad, 1 if lad is a secant latitude
+            const double phiD = p.lad * toRadian;
+            scale = n * rho(phiD) / (R * cos(phiD));
+        }
+
+        dx = p.dx * scale;
+        dy = p.dy * scale;
+        forward(grid.lat1, grid.lon1, x1, y1);
+    }
+
+    double rho(double phi) const {
+        return RF / pow(tan(M_PI / 4 + phi / 2), n);
+    }
+
+    void forward(double lat, double lon, double& x, double& y) const {
+        double d = fmod(lon - lov, 360.);
+        if (d >= 180.)
+            d -= 360.;
+        else if (d < -180.)
+            d += 360.;
+
+        const double theta = n * d * toRadian;
+        const double r = rho(lat * toRadian);
+        x = r * sin(theta);
+        y = -r * cos(theta);
+    }
+
+    /*
+     * Coordinates of count points at ordinate y, from abscissa x0 by step.
+     * Each formula is a loop over the row.
+     */
+    void inverseRow(double y, double x0, double step, int count,
+                    double *lats, double *lons) const {
+        const double s = n > 0 ? 1. : -1.;
+        const double invN = 1. / n;
+
+        // rho in lats, x in lons
+        for (int i = 0; i < count; i++) {
+            const double x = x0 + i * step;
+            lats[i] = s * sqrt(x * x + y * y);
+            lons[i] = x;
+        }
+
+        for (int i = 0; i < count; i++)
+            lons[i] = lov + atan2(s * lons[i], -s * y) * invN * toDegree;
+
+        for (int i = 0; i < count; i++)
+            lats[i] = 2. * atan(pow(RF / lats[i], invN)) * toDegree - 90.;
+
+        for (int i = 0; i < count; i++) {
+            lons[i] = fmod(lons[i], 360.);
+            if (lons[i] < 0.)
+                lons[i] += 360.;
+        }
+    }
+
+    double x1, y1, dx, dy;
+
+private:
+    double n, RF, lov;
+};
+
+bool sameDefinition(const Grid& a, const Grid& b)
+{
+    return a.earthRadius == b.earthRadius && a.ni == b.ni && a.nj == b.nj &&
+           a.lat1 == b.lat1 && a.lon1 == b.lon1 &&
+           sameProjection(a.projection, b.projection);
+}
+
+shared_ptr<Coordinates> computeCoordinates(const Grid& grid)
+{
+    TraceScope trace("coordinates");
+    const Projector projector(grid);
+    const size_t ni = grid.ni;
+
+    auto coordinates = make_shared<Coordinates>();
+    coordinates->grid = grid;
+    coordinates->lats.resize(ni * grid.nj);
+    coordinates->lons.resize(ni * grid.nj);
+
+    for (int j = 0; j < grid.nj; j++) {
+        projector.inverseRow(projector.y1 + j * projector.dy, projector.x1,
+                             projector.dx, ni, &coordinates->lats[j * ni],
+                             &coordinates->lons[j * ni]);
+    }
+
+    return coordinates;
+}
+
+} // local namespace
+
+bool sameProjection(const G2DEC_Projection& a, const G2DEC_Projection& b)
+{
+    return a.type == b.type && a.dx == b.dx && a.dy == b.dy &&
+           a.lad == b.lad && a.lov == b.lov && a.latin1 == b.latin1 &&
+           a.latin2 == b.latin2 && a.southPole == b.southPole;
+}
+
+void gridPoint(const Grid& grid, double i, double j, double& lat, double& lon)
+{
+    const Projector projector(grid);
+    projector.inverseRow(projector.y1 + j * projector.dy,
+                         projector.x1 + i * projector.dx, 0., 1, &lat, &lon);
+}
+
+void gridPositions(const Grid& grid, const vector<G2DEC_Point>& points,
+                   vector<double>& fi, vector<double>& fj)
+{
+    const Projector projector(grid);
+    fi.resize(points.size());
+    fj.resize(points.size());
+
+    for (size_t p = 0; p < points.size(); p++) {
+        double x, y;
+        projector.forward(points[p].lat, points[p].lon, x, y);
+        fi[p] = (x - projector.x1) / projector.dx;
+        fj[p] = (y - projector.y1) / projector.dy;
+    }
+}
+
+shared_ptr<const Coordinates> gridCoordinates(const Grid& grid)
+{
+    static mutex cacheMutex;
+    static vector<shared_ptr<const Coordinates>> cache;  // last used first
+
+    lock_guard<mutex> lock(cacheMutex);
+
+    for (size_t k = 0; k < cache.size(); k++) {
+        if (sameDefinition(cache[k]->grid, grid)) {
+            auto coordinates = cache[k];
+            cache.erase(cache.begin() + k);
+            cache.insert(cache.begin(), coordinates);
+            return coordinates;
+        }
+    }
+
+    cache.insert(cache.begin(), computeCoordinates(grid));
+    if (cache.size() > cacheSize)
+        cache.pop_back();
+
+    return cache.front();
+}
+
+} // grib2dec
@@ -0,0 +1,48 @@
+#ifndef __PROJECTION_HPP
+#define __PROJECTION_HPP
+
+#include "struct.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace grib2dec {
+
+/**
+ * Latitude and longitude of each point of a projected grid, in scanning
+ * order. Longitudes are in [0, 360[.
+ */
+struct Coordinates {
+    Grid grid;
+    std::vector<double> lats;
+    std::vector<double> lons;
+};
+
+inline bool projected(const Grid& grid)
+{
+    return grid.projection.type != G2DEC_PROJECTION_NONE;
+}
+
+bool sameProjection(const G2DEC_Projection& a, const G2DEC_Projection& b);
+
+/**
+ * Coordinates of fractional point (i, j) of a projected grid.
+ */
+void gridPoint(const Grid& grid, double i, double j, double& lat, double& lon);
+
+/**
+ * Fractional positions (i, j) of points in a projected grid, may be
+ * outside of the grid.
+ */
+void gridPositions(const Grid& grid, const std::vector<G2DEC_Point>& points,
+                   std::vector<double>& fi, std::vector<double>& fj);
+
+/**
+ * Coordinates lookup table of a projected grid, computed on first use by
+ * rows and shared by decoders. Last grids used are kept.
+ */
+std::shared_ptr<const Coordinates> gridCoordinates(const Grid& grid);
+
+} // grib2dec
+
+#endif
@@ -1,6 +1,14 @@
 #include "sections.hpp"
 #include "data.hpp"
-
+#include "gaussian.hpp"
+#include "grids.hpp"
+#include "points.hpp"
+#include "projection.hpp"
+#include "selection.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <sstream>
 #include <string.h>
 #include <vector>
 #include <math.h>
@@ -22,6 +30,52 @@ namespace {
 
 const bool debug = false;
 
+const char *const sectionNames[] = {
+    "indicator section", "identification section", "local section",
+    "grid section", "product section", "data representation section",
+    "bitmap section", "data section", "end section",
+};
+
+#ifdef GRIB2DEC_STATS
+// adds section time and length when leaving readSection
+class SectionStats {
+public:
+    SectionStats(Stream& stream) : stream(stream) {}
+
+    ~SectionStats() {
+        if (stream.stats && stream.sectionId >= 0 && stream.sectionId <= 8) {
+            G2DEC_Counter& counter = stream.stats->sections[stream.sectionId];
+            counter.bytes += stream.sectionLen;
+            timer.add(counter);
+        }
+    }
+
+private:
+    Stream& stream;
+    StatsTimer timer;
+};
+#endif
+
+// keep raw section with its header, stream stays at section body
+void keepRawSection(Stream& stream, string& raw)
+{
+    const streampos pos = stream.fin.tellg();
+
+    raw.resize(stream.sectionLen);
+    *(uint32_t*)&raw[0] = bigendian(uint32_t(stream.sectionLen));
+    raw[4] = stream.sectionId;
+
+    stream.fin.read(&raw[5], stream.sectionLen - 5);
+    if (!stream.fin)
+        throw parsing_error("end of file");
+
+    stream.fin.seekg(pos);
+    STATS(if (stream.stats) {
+        stream.stats->bytesRead += stream.sectionLen - 5;
+        stream.stats->seeks++;
+    })
+}
+
 void readIdentificationSection(Stream& stream, Message& message)
 {
     // generating center and subcenter
@@ -29,7 +83,7 @@ void readIdentificationSection(Stream& stream, Message& message)
 
     // table version
     if (stream.byte() != 2)
-        throw not_implemented("master table version number is not 2");
+        return unsupported(message, "master table version number is not 2");
 
     // version of local tables
     stream.read(1);
@@ -50,9 +104,9 @@ void readIdentificationSection(Stream& stream, Message& message)
     // production status
     stream.read(1);
 
-    // type of processed data
-    if (stream.byte() != 1)
-        throw not_implemented("not forecast data");
+    // type of processed data: analysis, forecast or ensemble forecasts
+    if (uint8_t(stream.byte()) > 5)
+        return unsupported(message, "not analysis or forecast data");
 
     stream.sectionEnd();
 }
@@ -62,10 +116,101 @@ void readLocalSection(Stream& stream)
     stream.sectionEnd();
 }
 
-void setSpatialFilter(Message& message)
+// rows filter of gaussian grids, by binary search in rows latitudes
+void setLatitudesFilter(Grid& grid, const vector<double>& latitudes,
+                        Filter& filter)
 {
-    Grid& grid = message.grid;
-    Filter& filter = message.filter;
+    const double epsilon = 1e-6;
+    const double latMin = filter.spatialFilter.latMin - epsilon;
+    const double latMax = filter.spatialFilter.latMax + epsilon;
+    const bool descending = grid.latInc < 0;
+
+    auto first = partition_point(latitudes.begin(), latitudes.end(), [&](double lat) {
+        return descending ? lat > latMax : lat < latMin;
+    });
+    auto last = partition_point(first, latitudes.end(), [&](double lat) {
+        return descending ? lat >= latMin : lat <= latMax;
+    });
+
+    // no intersection
+    if (first == last) {
+        filter.j.front = grid.nj;
+        filter.j.back = 0;
+        return;
+    }
+
+    filter.j.front = first - latitudes.begin();
+    filter.j.back = latitudes.end() - last;
+    grid.lat1 = *first;
+    grid.lat2 = *(last - 1);
+}
+
+// rows and columns filter of projected grids, smallest rectangle of grid
+// containing all points in filter, from coordinates table
+void setProjectedFilter(Grid& grid, Filter& filter)
+{
+    const G2DEC_SpatialFilter& f = filter.spatialFilter;
+    const bool latFilter = f.latMin || f.latMax;
+    const bool lonFilter = f.lonMin || f.lonMax;
+    const auto coordinates = gridCoordinates(grid);
+    const double *lats = coordinates->lats.data();
+    const double *lons = coordinates->lons.data();
+
+    auto inside = [&](size_t k) {
+        if (latFilter && (lats[k] < f.latMin || lats[k] > f.latMax))
+            return false;
+        if (!lonFilter)
+            return true;
+
+        // table longitudes are in [0, 360[
+        const double lon = lons[k];
+        return (lon >= f.lonMin && lon <= f.lonMax) ||
+               (lon - 360. >= f.lonMin && lon - 360. <= f.lonMax) ||
+               (lon + 360. >= f.lonMin && lon + 360. <= f.lonMax);
+    };
+
+    int iMin = grid.ni, iMax = -1, jMin = grid.nj, jMax = -1;
+    for (int j = 0; j < grid.nj; j++) {
+        const size_t row = size_t(j) * grid.ni;
+        for (int i = 0; i < grid.ni; i++) {
+            if (!inside(row + i))
+                continue;
+            iMin = min(iMin, i);
+            iMax = max(iMax, i);
+            jMin = min(jMin, j);
+            jMax = j;
+        }
+    }
+
+    // no intersection
+    if (iMax < 0) {
+        filter.i.front = grid.ni;
+        filter.i.back = 0;
+        filter.j.front = grid.nj;
+        filter.j.back = 0;
+        return;
+    }
+
+    filter.i.front = iMin;
+    filter.i.back = grid.ni - 1 - iMax;
+    filter.j.front = jMin;
+    filter.j.back = grid.nj - 1 - jMax;
+
+    grid.lat1 = lats[size_t(jMin) * grid.ni + iMin];
+    grid.lon1 = lons[size_t(jMin) * grid.ni + iMin];
+    grid.lat2 = lats[size_t(jMax) * grid.ni + iMax];
+    grid.lon2 = lons[size_t(jMax) * grid.ni + iMax];
+}
+
+void setSpatialFilter(Grid& grid, const vector<double>& latitudes,
+                      Filter& filter)
+{
+    if (projected(grid)) {
+        if (filter.spatialFilter.latMin || filter.spatialFilter.latMax ||
+            filter.spatialFilter.lonMin || filter.spatialFilter.lonMax)
+            setProjectedFilter(grid, filter);
+        return;
+    }
 
     if (filter.spatialFilter.lonMin || filter.spatialFilter.lonMax) {
         if (grid.lon1 < filter.spatialFilter.lonMin)
@@ -87,9 +232,18 @@ void setSpatialFilter(Message& message)
             grid.lon2 -= filter.i.back * grid.lonInc;
 
         assert(filter.i.back >= 0);
+
+        // no intersection
+        if (filter.i.front + filter.i.back > grid.ni) {
+            filter.i.front = grid.ni;
+            filter.i.back = 0;
+        }
     }
 
-    if (filter.spatialFilter.latMin || filter.spatialFilter.latMax) {
+    if ((filter.spatialFilter.latMin || filter.spatialFilter.latMax) &&
+        !latitudes.empty()) {
+        setLatitudesFilter(grid, latitudes, filter);
+    } else if (filter.spatialFilter.latMin || filter.spatialFilter.latMax) {
         if (grid.lat1 < filter.spatialFilter.latMin)
             filter.j.front = ceil((filter.spatialFilter.latMin - grid.lat1) / abs(grid.latInc));
         else if (grid.lat1 > filter.spatialFilter.latMax)
@@ -109,10 +263,17 @@ void setSpatialFilter(Message& message)
             grid.lat2 -= filter.j.back * grid.latInc;
 
         assert(filter.j.back >= 0);
+
+        // no intersection
+        if (filter.j.front + filter.j.back > grid.nj) {
+            filter.j.front = grid.nj;
+            filter.j.back = 0;
+        }
     }
 }
 
-void readGridTemplate0to3(Stream& stream, Message& message)
+// shape of earth, returns false if not handled
+bool readEarthShape(Stream& stream, Message& message)
 {
     Grid& grid = message.grid;
 
@@ -128,7 +289,8 @@ void readGridTemplate0to3(Stream& stream, Message& message)
         grid.earthRadius = 6371229.;
         break;
     default:
-        throw not_implemented("earth shape not handled (only sphericals)");
+        unsupported(message, "earth shape not handled (only sphericals)");
+        return false;
     }
 
     // earth radius
@@ -136,10 +298,62 @@ void readGridTemplate0to3(Stream& stream, Message& message)
     int earthRadiusScaled = stream.len32();
 
     if (grid.earthRadius == 0.)
-        grid.earthRadius = earthRadiusScaled / double(earthRadiusFactor);
+        grid.earthRadius = earthRadiusScaled / pow(10., earthRadiusFactor);
 
     // scale factors
     stream.read(10);
+    return true;
+}
+
+/*
+ * Scanning mode, returns false if not handled.
+ * 2 first bits are directions along i and j, given by grid limits or
+ * lengths signs. Values are decoded to raster order for column-major
+ * and boustrophedon scanning.
+ */
+bool readScanningMode(int scanningMode, Message& message)
+{
+    if (scanningMode & 0x0f) {
+        unsupported(message, "scanning mode: shifted rows are not supported");
+        return false;
+    }
+
+    message.columnMajor = scanningMode & 0x20;
+    message.boustrophedon = scanningMode & 0x10;
+    return true;
+}
+
+// filters and points weights, once grid is read
+void setGridFilters(Message& message)
+{
+    Grid& grid = message.grid;
+    message.definition = grid;
+
+    // set filters, regions first as they apply on the whole grid
+    for (Region& region : message.regions) {
+        region.grid = grid;
+        setSpatialFilter(region.grid, message.latitudes, region.filter);
+    }
+
+    setSpatialFilter(grid, message.latitudes, message.filter);
+
+    if (message.points)
+        message.pointWeights = &message.points->weights(grid);
+}
+
+/*
+ * Latitude / longitude grids, templates 3.0 to 3.3, and gaussian grids,
+ * template 3.40, where latitude increment is replaced by N.
+ */
+void readLatLonGridTemplate(Stream& stream, Message& message, bool gaussian)
+{
+    Grid& grid = message.grid;
+    grid.gaussianN = 0;
+    grid.projection = {};
+    message.latitudes.clear();
+
+    if (!readEarthShape(stream, message))
+        return;
 
     // Ni, Nj
     grid.ni = stream.len32();
@@ -173,24 +387,118 @@ void readGridTemplate0to3(Stream& stream, Message& message)
     int inci = abs(stream.magSigned32());
     int incj = abs(stream.magSigned32());
 
-    if (grid.lon2 < grid.lon1)
+    const int scanningMode = stream.byte();
+    if (!readScanningMode(scanningMode, message))
+        return;
+
+    /* boustrophedon: last point ends a reversed row (or column) when rows
+     * number is even, direction is given by scanning mode.
+     */
+    if (message.boustrophedon && !message.columnMajor && grid.nj % 2 == 0) {
+        inci = scanningMode & 0x80 ? -inci : inci;
+        grid.lon2 = grid.lon1 + (grid.ni - 1) * (inci / subA);
+    } else if (grid.lon2 < grid.lon1) {
         inci = -inci;
-    if (grid.lat2 < grid.lat1)
+    }
+
+    if (message.boustrophedon && message.columnMajor && grid.ni % 2 == 0) {
+        if (gaussian)
+            return unsupported(message, "scanning mode: boustrophedon columns on gaussian grid");
+        incj = scanningMode & 0x40 ? incj : -incj;
+        grid.lat2 = grid.lat1 + (grid.nj - 1) * (incj / subA);
+    } else if (grid.lat2 < grid.lat1) {
         incj = -incj;
+    }
 
     grid.lonInc = inci / subA;
     grid.latInc = incj / subA;
 
+    if (gaussian) {
+        grid.gaussianN = abs(incj);
+        if (!gaussianRows(grid, message.latitudes))
+            throw parsing_error("gaussian grid limits are not gaussian latitudes");
+
+        // mean increment
+        grid.latInc = grid.nj > 1 ? (grid.lat2 - grid.lat1) / (grid.nj - 1) : 0.;
+    }
+
+    setGridFilters(message);
+    stream.sectionEnd();
+}
+
+/*
+ * Projected grids: polar stereographic, template 3.20, and lambert
+ * conformal, template 3.30. Both begin with the same fields.
+ */
+void readProjectedGridTemplate(Stream& stream, Message& message,
+                               G2DEC_ProjectionType type)
+{
+    const double subdivision = 1e6;
+    Grid& grid = message.grid;
+    G2DEC_Projection& projection = grid.projection;
+    grid.gaussianN = 0;
+    grid.lonInc = grid.latInc = 0.;
+    projection = {};
+    projection.type = type;
+    message.latitudes.clear();
+
+    if (!readEarthShape(stream, message))
+        return;
+
+    // Nx, Ny
+    grid.ni = stream.len32();
+    grid.nj = stream.len32();
+
+    // first point
+    grid.lat1 = stream.magSigned32() / subdivision;
+    grid.lon1 = stream.magSigned32() / subdivision;
+
+    // component flag
+    stream.read(1);
+
+    projection.lad = stream.magSigned32() / subdivision;
+    projection.lov = stream.len32() / subdivision;
+
+    // grid lengths, in millimeter
+    projection.dx = stream.len32() / 1000.;
+    projection.dy = stream.len32() / 1000.;
+
+    // projection centre
+    const int centre = stream.byte();
+    projection.southPole = (centre & 0x80) != 0;
+    if (centre & 0x40)
+        return unsupported(message, "bi-polar projection is not supported");
+
     /* scanning mode.
-     * 2 first bits are redondants with limits min and max
-     * for increment sign.
+     * signs of grid lengths follow scanning directions.
      */
-    if (stream.byte() & 0xfc)
-        throw not_implemented("scanning mode: only raster is supported");
+    const int scanningMode = stream.byte();
+    if (!readScanningMode(scanningMode, message))
+        return;
+
+    if (scanningMode & 0x80)
+        projection.dx = -projection.dx;
+    if (!(scanningMode & 0x40))
+        projection.dy = -projection.dy;
 
-    // set filter
-    setSpatialFilter(message);
+    if (type == G2DEC_PROJECTION_LAMBERT) {
+        projection.latin1 = stream.magSigned32() / subdivision;
+        projection.latin2 = stream.magSigned32() / subdivision;
 
+        projection.latSouthPole = stream.magSigned32() / subdivision;
+        projection.lonSouthPole = stream.len32() / subdivision;
+
+        if (fabs(projection.latin1 + projection.latin2) < 1e-6)
+            return unsupported(message, "lambert projection with symmetric secant latitudes (cylinder)");
+    }
+
+    if (grid.ni <= 0 || grid.nj <= 0 || projection.dx == 0. || projection.dy == 0.)
+        throw parsing_error("projected grid with no point");
+
+    // last point
+    gridPoint(grid, grid.ni - 1, grid.nj - 1, grid.lat2, grid.lon2);
+
+    setGridFilters(message);
     stream.sectionEnd();
 }
 
@@ -198,7 +506,7 @@ void readGridDefinition(Stream& stream, Message& message)
 {
     // source of grid definition
     if (stream.byte() != 0)
-        throw not_implemented("source of grid definition other than 0 are not implemented");
+        return unsupported(message, "source of grid definition other than 0 are not implemented");
 
     // number of data points
     stream.read(4);
@@ -218,19 +526,120 @@ void readGridDefinition(Stream& stream, Message& message)
     case 1:
     case 2:
     case 3:
-        return readGridTemplate0to3(stream, message);
+        return readLatLonGridTemplate(stream, message, false);
+    case 20:
+        return readProjectedGridTemplate(stream, message, G2DEC_PROJECTION_POLAR_STEREOGRAPHIC);
+    case 30:
+        return readProjectedGridTemplate(stream, message, G2DEC_PROJECTION_LAMBERT);
+    case 40:
+        return readLatLonGridTemplate(stream, message, true);
     default:
-        throw not_implemented("only grid definition 0 to 3 is supported (latitude and longitude");
+        return unsupported(message, "only grid definition 0 to 3, 20, 30 and 40 are supported (latitude and longitude, polar stereographic, lambert, gaussian)");
     }
 }
 
+// code table value, 255 is missing
+int readCode(Stream& stream)
+{
+    const int code = uint8_t(stream.byte());
+    return code == 255 ? -1 : code;
+}
+
+G2DEC_TimeUnit readTimeUnit(Stream& stream)
+{
+    return static_cast<G2DEC_TimeUnit>(readCode(stream));
+}
+
+// scale factor and scaled value of a fixed surface, -1 if missing
+double readSurfaceValue(Stream& stream)
+{
+    stream.read(5);
+    const uint8_t factor = stream.data[0];
+    const uint32_t scaled = len32(stream.data + 1);
+
+    if (factor == 0xff || scaled == 0xffffffff)
+        return -1.;
+
+    // sign and magnitude
+    const int scale = factor & 0x80 ? -(factor & 0x7f) : factor;
+    const double value = scaled & 0x80000000 ? -double(scaled & 0x7fffffff) : scaled;
+
+    return scale >= 0 ? value / pow(10., scale) : value * pow(10., -scale);
+}
+
+// octets 12 to 34, common to templates 4.0 to 4.15
+void readProductTemplate40(Stream& stream, Product& product)
+{
+    // generating process type, background and forecast process identifiers
+    stream.read(3);
+
+    // observational data cut-off, hours and minutes
+    stream.read(3);
+
+    product.timeUnit = readTimeUnit(stream);
+
+    // sign and magnitude, all bits set if missing
+    const uint32_t forecastTime = stream.len32();
+    if (forecastTime != 0xffffffff) {
+        product.forecastTime = forecastTime & 0x7fffffff;
+        if (forecastTime & 0x80000000)
+            product.forecastTime = -product.forecastTime;
+    }
+
+    product.levelType = readCode(stream);
+    product.level = readSurfaceValue(stream);
+    product.levelType2 = readCode(stream);
+    product.level2 = readSurfaceValue(stream);
+}
+
+// ensemble octets of templates 4.1 and 4.11
+void readProductEnsemble(Stream& stream, Product& product)
+{
+    product.ensembleType = readCode(stream);
+    product.member = readCode(stream);
+    product.members = readCode(stream);
+}
+
+// statistics octets of templates 4.8 and 4.11, first time range kept
+void readProductStatistics(Stream& stream, Product& product)
+{
+    // end of overall time interval
+    stream.read(7);
+
+    Datetime& end = product.intervalEnd;
+    end.year = len16(stream.data);
+    end.month = stream.data[2];
+    end.day = stream.data[3];
+    end.hour = stream.data[4];
+    end.minute = stream.data[5];
+    end.second = stream.data[6];
+
+    // number of time ranges, and of values missing in statistics
+    const int nbTimeRanges = readCode(stream);
+    stream.read(4);
+
+    if (nbTimeRanges < 1)
+        throw parsing_error("statistical product without time range");
+
+    product.statistic = readCode(stream);
+
+    // type of time increment
+    stream.read(1);
+
+    product.intervalUnit = readTimeUnit(stream);
+    product.intervalLength = stream.len32();
+}
+
 void readProductionDefinition(Stream& stream, Message& message)
 {
+    Product& product = message.product;
+    product = missingProduct();
+
     // number of coords
     stream.read(2);
 
     // product definition template
-    stream.read(2);
+    product.tpl = stream.len16();
 
     // parameter category
     message.category = static_cast<Category>(stream.byte() + message.discipline * 1000);
@@ -243,9 +652,38 @@ void readProductionDefinition(Stream& stream, Message& message)
         throw parsing_error("Unknown parameter");
 #endif
 
+    // other templates are decoded without their product fields
+    switch (product.tpl) {
+    case 0:
+        readProductTemplate40(stream, product);
+        break;
+    case 1:
+        readProductTemplate40(stream, product);
+        readProductEnsemble(stream, product);
+        break;
+    case 8:
+        readProductTemplate40(stream, product);
+        readProductStatistics(stream, product);
+        break;
+    case 11:
+        readProductTemplate40(stream, product);
+        readProductEnsemble(stream, product);
+        readProductStatistics(stream, product);
+        break;
+    }
+
     stream.sectionEnd();
 }
 
+bool selected(const Message& message)
+{
+    for (const G2DEC_Selection& selection : *message.selections) {
+        if (matchesSelection(message.parameter, message.product, selection))
+            return true;
+    }
+    return false;
+}
+
 void readDataRepresentationTemplate53(Stream& stream, Message& message)
 {
     Packing& pack = message.packing;
@@ -256,10 +694,10 @@ void readDataRepresentationTemplate53(Stream& stream, Message& message)
     pack.R = stream.floatingPointNumber();
 
     // Binary scale factor E
-    pack.E = stream.len16();
+    pack.E = stream.magSigned16();
 
     // Decimal scale factor D
-    pack.D = stream.len16();
+    pack.D = stream.magSigned16();
 
     // Number of bits for each packed value
     pack.sampleBits = stream.byte();
@@ -278,7 +716,7 @@ void readDataRepresentationTemplate53(Stream& stream, Message& message)
 
     // missing value management
     if (stream.byte() != 0)
-        throw not_implemented("no missing pt management handled");
+        return unsupported(message, "no missing pt management handled");
 
     // missing values
     stream.read(8);
@@ -327,9 +765,8 @@ void readDataRepresentationTemplate53(Stream& stream, Message& message)
 
 void readDataRepresentation(Stream& stream, Message& message)
 {
+    // checked with bitmap in data section
     message.packing.nbValues = stream.len32();
-    if (message.packing.nbValues != message.grid.ni * message.grid.nj)
-        throw parsing_error("number of point is not ni x nj");
 
     message.packing.tpl = stream.len16();
 
@@ -339,14 +776,48 @@ void readDataRepresentation(Stream& stream, Message& message)
     case 3:
         return readDataRepresentationTemplate53(stream, message);
     default:
-        throw not_implemented("data representation template not handled");
+        return unsupported(message, "data representation template not handled");
     }
 }
 
+void readBitmapSection(Stream& stream, Message& message)
+{
+    switch (uint8_t(stream.byte())) {
+    case 255:
+        // no bitmap
+        message.useBitmap = false;
+        break;
+    case 254:
+        // bitmap defined by a previous field of message
+        if (!message.bitmapDefined)
+            throw parsing_error("no previous bitmap in message");
+        message.useBitmap = true;
+        break;
+    case 0:
+        message.bitmap.resize(stream.sectionRemain);
+        stream.fin.read((char*)message.bitmap.data(), message.bitmap.size());
+        if (!stream.fin)
+            throw parsing_error("end of file");
+
+        STATS(if (stream.stats) stream.stats->bytesRead += stream.sectionRemain;)
+        stream.sectionRemain = 0;
+        message.bitmapDefined = message.useBitmap = true;
+        break;
+    default:
+        return unsupported(message, "predefined bitmaps are not supported");
+    }
+
+    stream.sectionEnd();
+}
+
 } // local namespace
 
 void readIndicatorSection(Stream& stream, Message& message)
 {
+    TraceScope trace(sectionNames[0]);
+    STATS(StatsTimer timer(stream.stats ? &stream.stats->sections[0] : nullptr);)
+    STATS(if (stream.stats) stream.stats->sections[0].bytes += 16;)
+
     stream.sectionLen = stream.sectionRemain = 16;
     message.len = 0;
 
@@ -371,12 +842,53 @@ void readIndicatorSection(Stream& stream, Message& message)
     message.lenRead = stream.sectionLen;
 }
 
+/*
+ * Grid section, parsed once by grid definition with grids cache: grid,
+ * filters and points weights of previous message with the same raw
+ * section are reused.
+ */
+void readGridSection(Stream& stream, Message& message)
+{
+    if (!message.grids)
+        return readGridDefinition(stream, message);
+
+    string& raw = message.grids->section;
+    keepRawSection(stream, raw);
+
+    GridEntry& entry = message.grids->find(raw);
+    message.gridId = entry.id;
+
+    if (entry.parsed) {
+        entry.apply(message);
+        stream.sectionEnd();
+        return;
+    }
+
+    readGridDefinition(stream, message);
+    entry.store(message);
+}
+
+void reuseGridSection(Message& message)
+{
+    istringstream section(message.grids->section);
+    Stream stream(section);
+
+    stream.sectionBegin(message.grids->section.size());
+    readGridSection(stream, message);
+}
+
 void readSection(Stream& stream, Message& message, vector<double>& values)
 {
+    STATS(SectionStats sectionStats(stream);)
+    TraceScope trace;
+
     // section length
     stream.sectionBegin(message.len - message.lenRead);
     message.lenRead += stream.sectionLen;
 
+    if (stream.sectionId >= 0 && stream.sectionId <= 8)
+        trace.setName(sectionNames[stream.sectionId]);
+
     if (stream.sectionId == 8) {
         message.complete = true;
         return;
@@ -389,25 +901,37 @@ void readSection(Stream& stream, Message& message, vector<double>& values)
 
     switch (stream.sectionId) {
     case 1:
+        keepRawSection(stream, message.identificationSection);
         readIdentificationSection(stream, message);
         break;
     case 2:
         readLocalSection(stream);
         break;
     case 3:
-        readGridDefinition(stream, message);
+        readGridSection(stream, message);
         break;
     case 4:
+        keepRawSection(stream, message.productSection);
         readProductionDefinition(stream, message);
+        if (message.selections && !selected(message))
+            message.skipped = true;
         break;
     case 5:
-        readDataRepresentation(stream, message);
+        if (message.skipped)
+            stream.sectionEnd();
+        else
+            readDataRepresentation(stream, message);
         break;
     case 6:
-        stream.sectionEnd();
+        // read even when skipped, for next fields
+        readBitmapSection(stream, message);
         break;
     case 7:
-        readData(stream, message, values);
+        if (message.skipped)
+            stream.sectionEnd();
+        else
+            readData(stream, message, values);
+        message.fieldEnd = true;
         break;
 
     default:
@@ -11,6 +11,12 @@ namespace grib2dec {
 void readIndicatorSection(Stream& stream, Message& message);
 void readSection(Stream& stream, Message& message, vector<double>& values);
 
+/*
+ * Grid of a field following another one in the same message, from last
+ * grid section kept in grids cache, with current filters.
+ */
+void reuseGridSection(Message& message);
+
 } // grib2dec
 
 #endif
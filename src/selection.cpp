@@ -0,0 +1,93 @@
+#include "selection.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+namespace grib2dec {
+namespace {
+
+bool sameForecastTime(const Product& product, const G2DEC_Selection& selection)
+{
+    const long long a = unitSeconds(product.timeUnit);
+    const long long b = unitSeconds(selection.timeUnit);
+
+    if (a && b)
+        return product.forecastTime * a == selection.forecastTime * b;
+
+    return product.timeUnit == selection.timeUnit &&
+           product.forecastTime == selection.forecastTime;
+}
+
+} // local namespace
+
+long long unitSeconds(G2DEC_TimeUnit unit)
+{
+    switch (unit) {
+    case G2DEC_TIME_UNIT_SECOND:
+        return 1;
+    case G2DEC_TIME_UNIT_MINUTE:
+        return 60;
+    case G2DEC_TIME_UNIT_HOUR:
+        return 3600;
+    case G2DEC_TIME_UNIT_3_HOURS:
+        return 3 * 3600;
+    case G2DEC_TIME_UNIT_6_HOURS:
+        return 6 * 3600;
+    case G2DEC_TIME_UNIT_12_HOURS:
+        return 12 * 3600;
+    case G2DEC_TIME_UNIT_DAY:
+        return 24 * 3600;
+    default:
+        return 0;
+    }
+}
+
+long long forecastSeconds(const Product& product)
+{
+    const long long seconds = unitSeconds(product.timeUnit);
+    if (seconds == 0 || product.forecastTime < 0)
+        return -1;
+
+    return product.forecastTime * seconds;
+}
+
+long long datetimeSeconds(const Datetime& datetime)
+{
+    // days from civil date, with years beginning in march
+    const int y = datetime.year - (datetime.month <= 2);
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int yearOfEra = y - era * 400;
+    const int dayOfYear = (153 * (datetime.month + (datetime.month > 2 ? -3 : 9)) + 2) / 5 +
+                          datetime.day - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    const long long days = era * 146097LL + dayOfEra - 719468;
+
+    return days * 86400 + datetime.hour * 3600 + datetime.minute * 60 +
+           datetime.second;
+}
+
+bool matchesSelection(Parameter parameter, const Product& product,
+                      const G2DEC_Selection& selection)
+{
+    if (selection.parameter != G2DEC_PARAMETER_UNKNOWN &&
+        selection.parameter != parameter)
+        return false;
+
+    if (selection.levelType >= 0) {
+        if (selection.levelType != product.levelType)
+            return false;
+        if (selection.level != -1. &&
+            fabs(selection.level - product.level) > 1e-9 * max(1., fabs(selection.level)))
+            return false;
+    }
+
+    if (selection.forecastTime >= 0 && !sameForecastTime(product, selection))
+        return false;
+
+    return (selection.member < 0 || selection.member == product.member) &&
+           (selection.statistic < 0 || selection.statistic == product.statistic);
+}
+
+} // grib2dec
@@ -0,0 +1,32 @@
+#ifndef __SELECTION_HPP
+#define __SELECTION_HPP
+
+#include "struct.hpp"
+
+namespace grib2dec {
+
+/**
+ * Seconds of a time unit, 0 for months and longer units.
+ */
+long long unitSeconds(G2DEC_TimeUnit unit);
+
+/**
+ * Forecast time of a product in seconds, -1 if missing or in months and
+ * longer units.
+ */
+long long forecastSeconds(const Product& product);
+
+/**
+ * Seconds since 1970-01-01 00:00 UTC of a datetime.
+ */
+long long datetimeSeconds(const Datetime& datetime);
+
+/**
+ * Tells if a product matches a selection, see G2DEC_Selection.
+ */
+bool matchesSelection(Parameter parameter, const Product& product,
+                      const G2DEC_Selection& selection);
+
+} // grib2dec
+
+#endif
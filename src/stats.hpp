@@ -0,0 +1,80 @@
+#ifndef __STATS_HPP
+#define __STATS_HPP
+
+#include "grib2dec/types.h"
+
+/*
+ * Decoding statistics, compiled only with GRIB2DEC_STATS option.
+ *
+ * STATS(statements) is removed without the option, so that counters and
+ * timers are not updated. Statistics structures are kept in any case.
+ */
+
+#ifdef GRIB2DEC_STATS
+
+#include <chrono>
+
+#define STATS(...) __VA_ARGS__
+
+namespace grib2dec {
+
+// adds time spent in scope to a counter
+class StatsTimer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    StatsTimer(G2DEC_Counter *counter = nullptr)
+        : counter(counter), begin(clock::now()) {}
+
+    ~StatsTimer() {
+        if (counter)
+            add(*counter);
+    }
+
+    void add(G2DEC_Counter& target) {
+        target.count++;
+        target.seconds += std::chrono::duration<double>(clock::now() - begin).count();
+        counter = nullptr;
+    }
+
+private:
+    G2DEC_Counter *counter;
+    clock::time_point begin;
+};
+
+// adds time spent and bytes read in scope to a decoding phase
+class PhaseTimer {
+public:
+    PhaseTimer(G2DEC_Stats *stats, G2DEC_Phase phase)
+        : stats(stats), phase(phase), bytesRead(stats ? stats->bytesRead : 0) {}
+
+    ~PhaseTimer() {
+        end();
+    }
+
+    void end() {
+        if (!stats)
+            return;
+
+        G2DEC_Counter& counter = stats->phases[phase];
+        counter.bytes += stats->bytesRead - bytesRead;
+        timer.add(counter);
+        stats = nullptr;
+    }
+
+private:
+    G2DEC_Stats *stats;
+    G2DEC_Phase phase;
+    long long bytesRead;
+    StatsTimer timer;
+};
+
+} // grib2dec
+
+#else
+
+#define STATS(...)
+
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef __STREAM_HPP
 #define __STREAM_HPP
 
+#include "stats.hpp"
 #include "utils.hpp"
 
 #include <istream>
@@ -34,6 +35,7 @@ public:
             throw parsing_error("end of file");
 
         sectionRemain -= len;
+        STATS(if (stats) stats->bytesRead += len;)
     }
 
     int bits(int nbBits) {
@@ -157,6 +159,7 @@ public:
     }
 
     void sectionEnd() {
+        STATS(if (stats) stats->seeks++;)
         fin.seekg(sectionRemain, ios_base::cur);
         if (fin.eof())
             throw parsing_error("file too small for section size");
@@ -171,6 +174,9 @@ public:
     // read bits status
     int nbBitsRead = 0;
     uint64_t bitsReadValue = 0;
+
+    // same layout with or without statistics, stream is used by apps
+    G2DEC_Stats *stats = nullptr;
 };
 
 } // grib2dec
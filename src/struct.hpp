@@ -3,6 +3,10 @@
 
 #include "grib2dec/types.h"
 
+#include <stdint.h>
+#include <string>
+#include <vector>
+
 namespace grib2dec {
 
 typedef G2DEC_Discipline Discipline;
@@ -10,6 +14,11 @@ typedef G2DEC_Category Category;
 typedef G2DEC_Parameter Parameter;
 typedef G2DEC_Datetime Datetime;
 typedef G2DEC_Grid Grid;
+typedef G2DEC_Product Product;
+
+class GridCache;
+class PointsQuery;
+struct PointWeights;
 
 struct Filter {
     struct Skip {
@@ -19,8 +28,28 @@ struct Filter {
     Skip j;
 
     G2DEC_SpatialFilter spatialFilter;
+    G2DEC_Decimation decimation = {1, 1, 0};
+};
+
+struct Region {
+    Filter filter;
+    Grid grid;
+    std::vector<double> values;
 };
 
+inline Product missingProduct()
+{
+    Product product;
+    product.tpl = product.levelType = product.levelType2 = -1;
+    product.level = product.level2 = -1.;
+    product.forecastTime = product.intervalLength = -1;
+    product.timeUnit = product.intervalUnit = G2DEC_TIME_UNIT_MISSING;
+    product.ensembleType = product.member = product.members = -1;
+    product.statistic = -1;
+    product.intervalEnd = {-1, -1, -1, -1, -1, -1};
+    return product;
+}
+
 struct Packing {
     int tpl = -1;  // 0, 2 or 3
     int nbValues = 0;
@@ -46,13 +75,60 @@ struct Message {
     bool complete = false;
     int lenRead = 0;
     Grid grid;
+    Grid definition;                // grid before filters
+    std::vector<double> latitudes;  // rows latitudes of gaussian grids
+    bool columnMajor = false;       // adjacent points along meridians
+    bool boustrophedon = false;     // every other row (column) reversed
     Discipline discipline = G2DEC_DISCIPLINE_UNKNOWN;
     Category category = G2DEC_CATEGORY_UNKNOWN;
     Parameter parameter = G2DEC_PARAMETER_UNKNOWN;
+    Product product = missingProduct();
     Packing packing;
     Filter filter;
+
+    // bitmap of points present in data, in scan order: last bitmap read in
+    // message, kept for next fields
+    std::vector<uint8_t> bitmap;
+    bool bitmapDefined = false;
+    bool useBitmap = false;  // bitmap applies to current field
+
+    std::vector<Region> regions;
+    PointsQuery *points = nullptr;
+    const PointWeights *pointWeights = nullptr;
+
+    // grid definitions met by decoder, grid section is parsed once
+    GridCache *grids = nullptr;
+    int gridId = -1;
+
+    // messages not matching selections are skipped after product section
+    const std::vector<G2DEC_Selection> *selections = nullptr;
+    bool skipped = false;
+
+    // sections 3 to 7 may be repeated: a message has several fields,
+    // read one by one up to their data section
+    int field = 0;
+    bool fieldEnd = false;
+
+    // raw sections, with header, to write message back
+    std::string identificationSection;
+    std::string productSection;
+
+    // set when message uses an unsupported feature, see unsupported()
+    G2DEC_Status status = G2DEC_STATUS_OK;
+    const char *error = nullptr;
 };
 
+/*
+ * Unsupported feature : message reading stops and message is skipped,
+ * without exception as it is frequent in mixed files. Exceptions are
+ * kept for malformed messages.
+ */
+inline void unsupported(Message& message, const char *error)
+{
+    message.status = G2DEC_STATUS_NOT_IMPLEMENTED;
+    message.error = error;
+}
+
 } // grib2dec
 
 #endif
@@ -0,0 +1,216 @@
+#include "grib2dec/grib2dec.hpp"
+#include "trace.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace grib2dec {
+
+atomic<bool> traceOn(false);
+
+namespace {
+
+using clock = chrono::steady_clock;
+
+struct TraceEvent {
+    const char *name;
+    int64_t begin;
+    int64_t end;
+};
+
+/*
+ * Events buffer of a thread, as a list of chunks. Owner thread appends
+ * events and publishes their count, trace writer reads published events.
+ */
+class TraceBuffer {
+public:
+    static const int chunkSize = 4096;
+
+    struct Chunk {
+        TraceEvent events[chunkSize];
+        atomic<Chunk*> next{nullptr};
+    };
+
+    TraceBuffer(int threadId) : threadId(threadId) {}
+
+    ~TraceBuffer() {
+        for (Chunk *chunk = first.next.load(); chunk; ) {
+            Chunk *next = chunk->next.load();
+            delete chunk;
+            chunk = next;
+        }
+    }
+
+    void add(const TraceEvent& event) {
+        const size_t n = count.load(memory_order_relaxed);
+        const int slot = n % chunkSize;
+
+        if (n > 0 && slot == 0) {
+            // next chunk, kept when buffer is reset
+            Chunk *next = last->next.load(memory_order_relaxed);
+            if (!next) {
+                next = new Chunk;
+                last->next.store(next, memory_order_release);
+            }
+            last = next;
+        }
+
+        last->events[slot] = event;
+        count.store(n + 1, memory_order_release);
+    }
+
+    // only when no event is added
+    void reset() {
+        count.store(0, memory_order_relaxed);
+        last = &first;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        const size_t n = count.load(memory_order_acquire);
+        const Chunk *chunk = &first;
+
+        for (size_t k = 0; k < n; k++) {
+            if (k > 0 && k % chunkSize == 0)
+                chunk = chunk->next.load(memory_order_acquire);
+            f(chunk->events[k % chunkSize]);
+        }
+    }
+
+    const int threadId;
+
+private:
+    Chunk first;
+    Chunk *last = &first;
+    atomic<size_t> count{0};
+};
+
+struct Trace {
+    clock::time_point start = clock::now();
+
+    // buffers of all threads, a buffer of an ended thread is reused by
+    // next new thread, after events of ended thread
+    mutex buffersMutex;
+    vector<unique_ptr<TraceBuffer>> buffers;
+    vector<TraceBuffer*> freeBuffers;
+};
+
+Trace& trace()
+{
+    static Trace instance;
+    return instance;
+}
+
+// buffer of a thread, given back to free buffers at thread end
+class BufferOwner {
+public:
+    ~BufferOwner() {
+        if (!buffer)
+            return;
+        Trace& t = trace();
+        lock_guard<mutex> lock(t.buffersMutex);
+        t.freeBuffers.push_back(buffer);
+    }
+
+    TraceBuffer *buffer = nullptr;
+};
+
+TraceBuffer& threadBuffer()
+{
+    thread_local BufferOwner owner;
+
+    if (!owner.buffer) {
+        Trace& t = trace();
+        lock_guard<mutex> lock(t.buffersMutex);
+        if (!t.freeBuffers.empty()) {
+            owner.buffer = t.freeBuffers.back();
+            t.freeBuffers.pop_back();
+        } else {
+            t.buffers.emplace_back(new TraceBuffer(t.buffers.size() + 1));
+            owner.buffer = t.buffers.back().get();
+        }
+    }
+
+    return *owner.buffer;
+}
+
+void writeString(ostream& out, const char *s)
+{
+    out << '"';
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            out << '\\';
+        out << *s;
+    }
+    out << '"';
+}
+
+} // local namespace
+
+int64_t traceClock()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(clock::now() - trace().start).count();
+}
+
+void traceEvent(const char *name, int64_t begin, int64_t end)
+{
+    threadBuffer().add({name, begin, end});
+}
+
+void startTrace()
+{
+    Trace& t = trace();
+
+    {
+        lock_guard<mutex> lock(t.buffersMutex);
+        for (auto& buffer : t.buffers)
+            buffer->reset();
+    }
+
+    t.start = clock::now();
+    traceOn.store(true);
+}
+
+G2DEC_Status stopTrace(const char *filename)
+{
+    traceOn.store(false);
+
+    ofstream out(filename);
+    if (!out.is_open())
+        return G2DEC_STATUS_ERROR;
+
+    Trace& t = trace();
+    lock_guard<mutex> lock(t.buffersMutex);
+
+    // complete events, time in microseconds
+    out << fixed << setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool firstEvent = true;
+
+    for (const auto& buffer : t.buffers) {
+        out << (firstEvent ? "\n" : ",\n")
+            << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+            << buffer->threadId << ", \"args\": {\"name\": \"thread "
+            << buffer->threadId << "\"}}";
+        firstEvent = false;
+
+        buffer->forEach([&](const TraceEvent& event) {
+            out << ",\n{\"name\": ";
+            writeString(out, event.name);
+            out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->threadId
+                << ", \"ts\": " << event.begin / 1000.
+                << ", \"dur\": " << (event.end - event.begin) / 1000. << "}";
+        });
+    }
+
+    out << "\n]}\n";
+    return out ? G2DEC_STATUS_OK : G2DEC_STATUS_ERROR;
+}
+
+} // grib2dec
@@ -0,0 +1,52 @@
+#ifndef __TRACE_HPP
+#define __TRACE_HPP
+
+#include <atomic>
+#include <stdint.h>
+
+namespace grib2dec {
+
+/*
+ * Decoding timeline, see startTrace() and stopTrace().
+ *
+ * Events are recorded in per-thread buffers, without lock: only the
+ * owner thread writes in its buffer.
+ */
+
+extern std::atomic<bool> traceOn;
+
+// nanoseconds since trace start
+int64_t traceClock();
+
+void traceEvent(const char *name, int64_t begin, int64_t end);
+
+// records an event for the scope, name can be set before scope end
+class TraceScope {
+public:
+    TraceScope(const char *name = nullptr)
+        : name(name),
+          begin(traceOn.load(std::memory_order_relaxed) ? traceClock() : -1) {}
+
+    ~TraceScope() {
+        end();
+    }
+
+    void setName(const char *newName) {
+        name = newName;
+    }
+
+    // records event before scope end
+    void end() {
+        if (begin >= 0 && name)
+            traceEvent(name, begin, traceClock());
+        begin = -1;
+    }
+
+private:
+    const char *name;
+    int64_t begin;
+};
+
+} // grib2dec
+
+#endif
@@ -35,10 +35,17 @@ private:
     G2DEC_Status errorStatus;
 };
 
-class not_implemented : public parsing_error {
+class encoding_error : public parsing_error {
 public:
-    not_implemented(const std::string& msg)
-        : parsing_error(msg, G2DEC_STATUS_NOT_IMPLEMENTED, "not implemented")
+    encoding_error(const std::string& msg)
+        : parsing_error(msg, G2DEC_STATUS_ERROR, "encoding error")
+    {}
+};
+
+class cube_error : public parsing_error {
+public:
+    cube_error(const std::string& msg)
+        : parsing_error(msg, G2DEC_STATUS_ERROR, "cube error")
     {}
 };
 
@@ -0,0 +1,285 @@
+#include "grib2dec/grib2dec.hpp"
+#include "points.hpp"
+#include "selection.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace grib2dec {
+namespace {
+
+const double epsilon = 1e-6;
+
+// queries by batch: positions and weights of a batch stay in cache
+const int batchSize = 256;
+
+// wind components of a valid time, u and v interleaved by point
+struct Field {
+    vector<float> uv;
+    bool hasU = false;
+    bool hasV = false;
+
+    bool complete() const {
+        return hasU && hasV;
+    }
+};
+
+class Wind : public WindQuery {
+public:
+    Wind() {
+        zero(grid);
+    }
+
+    void setLevel(int levelType, double level) override {
+        this->levelType = levelType;
+        this->level = level;
+    }
+
+    void setTimeRange(double begin, double end) override {
+        rangeBegin = begin;
+        rangeEnd = end;
+        prune();
+        update();
+    }
+
+    G2DEC_Status load(const char *filename) override {
+        unique_ptr<Grib2Dec> decoder(Grib2Dec::create(filename));
+        if (!decoder) {
+            lastError = string("wind query: cannot open ") + filename;
+            return G2DEC_STATUS_ERROR;
+        }
+
+        return loadFields(*decoder);
+    }
+
+    G2DEC_Status load(istream& fin) override {
+        unique_ptr<Grib2Dec> decoder(Grib2Dec::create(fin));
+        return loadFields(*decoder);
+    }
+
+    const char *getLastError() const override {
+        return lastError.c_str();
+    }
+
+    void getTimes(const double *&times, int& length) const override {
+        times = this->times.data();
+        length = this->times.size();
+    }
+
+    G2DEC_Status query(const G2DEC_WindPoint *points, int nbPoints,
+                       double *u, double *v) const override {
+        if (nbPoints < 0 || (nbPoints > 0 && (!points || !u || !v)))
+            return G2DEC_STATUS_ERROR;
+
+        TraceScope trace("wind query");
+
+        for (int begin = 0; begin < nbPoints; begin += batchSize) {
+            queryBatch(points + begin, min(batchSize, nbPoints - begin),
+                       u + begin, v + begin);
+        }
+
+        return G2DEC_STATUS_OK;
+    }
+
+private:
+    G2DEC_Status loadFields(Grib2Dec& decoder) {
+        TraceScope trace("wind loading");
+        lastError.clear();
+
+        const G2DEC_Selection selections[2] = {
+            {G2DEC_PARAMETER_WIND_U, levelType, level, -1, G2DEC_TIME_UNIT_HOUR, -1, -1},
+            {G2DEC_PARAMETER_WIND_V, levelType, level, -1, G2DEC_TIME_UNIT_HOUR, -1, -1},
+        };
+        decoder.setSelections(selections, 2);
+
+        G2DEC_Message message;
+        G2DEC_Status status, result = G2DEC_STATUS_OK;
+
+        while ((status = decoder.nextMessage(message)) != G2DEC_STATUS_END) {
+            if (status != G2DEC_STATUS_OK || !message.values)
+                continue;
+
+            const long long forecast = forecastSeconds(message.product);
+            if (forecast < 0)
+                continue;
+
+            result = setGrid(message.grid);
+            if (result != G2DEC_STATUS_OK)
+                break;
+
+            const double time = datetimeSeconds(message.datetime) + forecast;
+            const size_t nbPoints = size_t(grid.ni) * grid.nj;
+            const int component = message.parameter == G2DEC_PARAMETER_WIND_U ? 0 : 1;
+
+            Field& field = fields[time];
+            field.uv.resize(2 * nbPoints, NAN);
+            for (size_t k = 0; k < nbPoints; k++)
+                field.uv[2 * k + component] = message.values[k];
+
+            (component ? field.hasV : field.hasU) = true;
+            if (field.complete())
+                prune();
+        }
+
+        update();
+        return result;
+    }
+
+    // grid of first field, same for all fields
+    G2DEC_Status setGrid(const Grid& messageGrid) {
+        if (messageGrid.projection.type != G2DEC_PROJECTION_NONE ||
+            messageGrid.gaussianN) {
+            lastError = "wind query: only regular latitude / longitude grids";
+            return G2DEC_STATUS_NOT_IMPLEMENTED;
+        }
+
+        if (fields.empty()) {
+            grid = messageGrid;
+            global = fabs(grid.ni * grid.lonInc) >= 360. - epsilon;
+            period = grid.lonInc ? 360. / fabs(grid.lonInc) : 1.;
+        } else if (!sameGrid(grid, messageGrid)) {
+            lastError = "wind query: grid differs from grid of loaded fields";
+            return G2DEC_STATUS_ERROR;
+        }
+
+        return G2DEC_STATUS_OK;
+    }
+
+    // drops fields before last complete field at range begin, and after
+    // first complete field at range end
+    void prune() {
+        double first = -INFINITY, last = INFINITY;
+
+        for (const auto& f : fields) {
+            if (!f.second.complete())
+                continue;
+            if (f.first <= rangeBegin)
+                first = f.first;
+            if (f.first >= rangeEnd && last == INFINITY)
+                last = f.first;
+        }
+
+        fields.erase(fields.begin(), fields.lower_bound(first));
+        fields.erase(fields.upper_bound(last), fields.end());
+    }
+
+    // times and values of complete fields, for queries
+    void update() {
+        times.clear();
+        values.clear();
+
+        for (const auto& f : fields) {
+            if (f.second.complete()) {
+                times.push_back(f.first);
+                values.push_back(f.second.uv.data());
+            }
+        }
+    }
+
+    /*
+     * Each step is a loop over the batch: grid positions, then time
+     * positions, then interpolation of 4 points at 2 times.
+     */
+    void queryBatch(const G2DEC_WindPoint *points, int n,
+                    double *u, double *v) const {
+        double fi[batchSize], fj[batchSize], ft[batchSize];
+        int slot[batchSize];
+
+        const double invLonInc = grid.lonInc ? 1. / grid.lonInc : 0.;
+        const double invLatInc = grid.latInc ? 1. / grid.latInc : 0.;
+
+        for (int q = 0; q < n; q++) {
+            const double i = (points[q].lon - grid.lon1) * invLonInc;
+            fi[q] = i - period * floor(i / period);
+            fj[q] = (points[q].lat - grid.lat1) * invLatInc;
+        }
+
+        const int nbTimes = times.size();
+        for (int q = 0; q < n; q++) {
+            const double t = points[q].time;
+            if (!(nbTimes > 0 && t >= times.front() && t <= times.back())) {
+                slot[q] = -1;
+                continue;
+            }
+
+            // times[k] <= t < times[k + 1], or t is last time
+            const int k = upper_bound(times.begin(), times.end(), t) - times.begin() - 1;
+            slot[q] = k;
+            ft[q] = k + 1 < nbTimes ? (t - times[k]) / (times[k + 1] - times[k]) : 0.;
+        }
+
+        const int ni = grid.ni, nj = grid.nj;
+        for (int q = 0; q < n; q++) {
+            double x = fi[q], y = fj[q];
+
+            // rounding error just before first column
+            if (period - x < epsilon)
+                x = 0.;
+
+            if (slot[q] < 0 || !(y > -epsilon && y < nj - 1 + epsilon) ||
+                !(x >= 0.) || (!global && x > ni - 1 + epsilon)) {
+                u[q] = v[q] = NAN;
+                continue;
+            }
+
+            y = max(0., min<double>(y, nj - 1));
+
+            const int i0 = min<int>(x, ni - 1);
+            const int j0 = min<int>(y, nj - 1);
+            int i1 = i0 + 1;
+            if (i1 >= ni)
+                i1 = global ? 0 : ni - 1;
+            const int j1 = min(j0 + 1, nj - 1);
+
+            const double di = min(x - i0, 1.), dj = y - j0;
+            const double w00 = (1. - di) * (1. - dj), w01 = di * (1. - dj);
+            const double w10 = (1. - di) * dj, w11 = di * dj;
+
+            const size_t k00 = 2 * (size_t(j0) * ni + i0), k01 = 2 * (size_t(j0) * ni + i1);
+            const size_t k10 = 2 * (size_t(j1) * ni + i0), k11 = 2 * (size_t(j1) * ni + i1);
+
+            const int k = slot[q];
+            const float *a = values[k];
+            const float *b = values[k + 1 < nbTimes ? k + 1 : k];
+            const double wa = 1. - ft[q], wb = ft[q];
+
+            u[q] = wa * (w00 * a[k00] + w01 * a[k01] + w10 * a[k10] + w11 * a[k11]) +
+                   wb * (w00 * b[k00] + w01 * b[k01] + w10 * b[k10] + w11 * b[k11]);
+            v[q] = wa * (w00 * a[k00 + 1] + w01 * a[k01 + 1] + w10 * a[k10 + 1] + w11 * a[k11 + 1]) +
+                   wb * (w00 * b[k00 + 1] + w01 * b[k01 + 1] + w10 * b[k10 + 1] + w11 * b[k11 + 1]);
+        }
+    }
+
+    int levelType = 103;
+    double level = 10.;
+    double rangeBegin = -INFINITY, rangeEnd = INFINITY;
+
+    Grid grid;
+    bool global = false;
+    double period = 0.;
+
+    map<double, Field> fields;  // by valid time
+
+    // complete fields, by increasing time
+    vector<double> times;
+    vector<const float*> values;
+
+    string lastError;
+};
+
+} // local namespace
+
+WindQuery *WindQuery::create()
+{
+    return new Wind();
+}
+
+} // grib2dec
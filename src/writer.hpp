@@ -0,0 +1,101 @@
+#ifndef __WRITER_HPP
+#define __WRITER_HPP
+
+#include <stdint.h>
+#include <string>
+
+namespace grib2dec {
+
+/*
+ * Writing of grib2 messages: big endian integers, sign and magnitude
+ * values as read by Stream, bits packing and sections. Used by encoder,
+ * and by benchmarks generator.
+ */
+
+class BitWriter {
+public:
+    BitWriter(std::string& out) : out(out) {}
+
+    void bits(uint32_t v, int nbBits) {
+        if (nbBits == 0)
+            return;
+
+        acc = (acc << nbBits) | (uint64_t(v) & ((uint64_t(1) << nbBits) - 1));
+        nb += nbBits;
+
+        while (nb >= 8) {
+            nb -= 8;
+            out += char(acc >> nb);
+        }
+
+        acc &= (uint64_t(1) << nb) - 1;
+    }
+
+    // pad to byte
+    void end() {
+        if (nb)
+            out += char(acc << (8 - nb));
+        acc = 0;
+        nb = 0;
+    }
+
+private:
+    std::string& out;
+    uint64_t acc = 0;
+    int nb = 0;
+};
+
+inline void put8(std::string& s, int v)
+{
+    s += char(v);
+}
+
+inline void put16(std::string& s, int v)
+{
+    put8(s, v >> 8);
+    put8(s, v);
+}
+
+inline void put32(std::string& s, uint32_t v)
+{
+    put16(s, v >> 16);
+    put16(s, v);
+}
+
+inline void put64(std::string& s, uint64_t v)
+{
+    put32(s, v >> 32);
+    put32(s, v);
+}
+
+// sign and magnitude, as read by Stream
+inline uint16_t magSigned16(int v)
+{
+    return v < 0 ? uint16_t(-v) | 0x8000 : uint16_t(v);
+}
+
+inline uint32_t magSigned32(int v)
+{
+    return v < 0 ? uint32_t(-v) | 0x80000000u : uint32_t(v);
+}
+
+// bits needed by v
+inline int nbBits(uint32_t v)
+{
+    int n = 0;
+    while (n < 32 && (v >> n))
+        n++;
+    return n;
+}
+
+// appends section of body to out
+inline void section(std::string& out, int id, const std::string& body)
+{
+    put32(out, body.size() + 5);
+    put8(out, id);
+    out += body;
+}
+
+} // grib2dec
+
+#endif